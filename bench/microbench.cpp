@@ -0,0 +1,284 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Microbenchmarks of the components on the recognition hot path, measured on
+// the data of a real NameTag model and a corpus.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+#include "classifier/network_classifier.h"
+#include "features/feature_templates.h"
+#include "morphodita/tagger/tagger.h"
+#include "ner/entity_map.h"
+#include "ner/ner.h"
+#include "tagger/tagger.h"
+#include "unilib/uninorms.h"
+#include "unilib/utf8.h"
+#include "utils/getpara.h"
+#include "utils/iostreams.h"
+#include "utils/options.h"
+#include "utils/parse_int.h"
+#include "utils/path_from_utf8.h"
+#include "utils/url_detector.h"
+
+using namespace ufal::nametag;
+
+static string filter;
+static unsigned warmup, repetitions;
+static volatile size_t sink;
+
+// Run the benchmark, which performs the given number of operations and
+// returns a checksum, and print statistics of the time per operation.
+template <class Benchmark>
+static void benchmark(const string& name, size_t operations, Benchmark f) {
+  if (name.find(filter) == string::npos || !operations) return;
+
+  for (unsigned i = 0; i < warmup; i++)
+    sink = sink + f();
+
+  vector<double> times;
+  for (unsigned i = 0; i < repetitions; i++) {
+    auto start = chrono::steady_clock::now();
+    sink = sink + f();
+    times.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / operations);
+  }
+
+  sort(times.begin(), times.end());
+  double mean = 0, variance = 0;
+  for (auto&& time : times) mean += time / times.size();
+  for (auto&& time : times) variance += (time - mean) * (time - mean) / times.size();
+
+  cout << left << setw(45) << name << right << setw(10) << operations << fixed << setprecision(1)
+       << setw(12) << times.front() << setw(12) << times[times.size() / 2]
+       << setw(12) << mean << setw(12) << sqrt(variance) << endl;
+  cout.unsetf(ios::floatfield);
+}
+
+int main(int argc, char* argv[]) {
+  iostreams_init();
+
+  options::map options;
+  if (!options::parse({{"morphodita_tagger", options::value::any},
+                       {"warmup", options::value::any},
+                       {"repetitions", options::value::any},
+                       {"filter", options::value::any},
+                       {"help", options::value::none}}, argc, argv, options) ||
+      options.count("help") || argc != 3)
+    runtime_failure("Usage: " << argv[0] << " [options] recognizer_model corpus_file\n"
+                    "Options: --morphodita_tagger=MorphoDiTa tagger model for morphology benchmarks\n"
+                    "         --warmup=number of warmup runs (default 1)\n"
+                    "         --repetitions=number of measured runs (default 10)\n"
+                    "         --filter=run only benchmarks containing the given string\n"
+                    "         --help");
+
+  warmup = options.count("warmup") ? parse_int(options["warmup"], "warmup runs") : 1;
+  repetitions = options.count("repetitions") ? parse_int(options["repetitions"], "repetitions") : 10;
+  if (!repetitions) runtime_failure("The number of repetitions must be positive!");
+  filter = options["filter"];
+
+  // Load the recognizer, and then its components individually
+  unique_ptr<ner> recognizer(ner::load(argv[1]));
+  if (!recognizer) runtime_failure("Cannot load ner from file '" << argv[1] << "'!");
+  unique_ptr<tokenizer> tokenizer(recognizer->new_tokenizer());
+  if (!tokenizer) runtime_failure("No tokenizer is defined for the supplied model!");
+
+  ifstream model(path_from_utf8(argv[1]).c_str(), ifstream::in | ifstream::binary);
+  unique_ptr<tagger> tagger;
+  entity_map entities;
+  feature_templates templates;
+  vector<network_classifier> networks;
+  if (model.get() == EOF || (tagger.reset(tagger::load_instance(model)), !tagger) || !entities.load(model) ||
+      !templates.load(model, nlp_pipeline(tokenizer.get(), tagger.get())))
+    runtime_failure("Cannot load the components of ner from file '" << argv[1] << "'!");
+  int stages = model.get();
+  if (stages == EOF) runtime_failure("Cannot load the components of ner from file '" << argv[1] << "'!");
+  networks.resize(stages);
+  for (auto&& network : networks)
+    if (!network.load(model)) runtime_failure("Cannot load the components of ner from file '" << argv[1] << "'!");
+
+  // Load the corpus and prepare the data of individual benchmarks
+  ifstream corpus_file(path_from_utf8(argv[2]).c_str());
+  if (!corpus_file.is_open()) runtime_failure("Cannot open corpus file '" << argv[2] << "'!");
+  vector<string> paragraphs;
+  for (string para; getpara(corpus_file, para); )
+    paragraphs.push_back(para);
+
+  vector<vector<string_piece>> sentences;
+  vector<string_piece> forms;
+  size_t words = 0;
+  for (auto&& paragraph : paragraphs) {
+    tokenizer->set_text(paragraph);
+    while (tokenizer->next_sentence(&forms, nullptr))
+      sentences.push_back(forms), words += forms.size();
+  }
+
+  vector<ner_sentence> tagged(sentences.size());
+  string buffer;
+  for (size_t i = 0; i < sentences.size(); i++) {
+    tagger->tag(sentences[i], tagged[i]);
+    tagged[i].clear_previous_stage();
+    templates.process_sentence(tagged[i], buffer);
+  }
+
+  vector<u32string> decoded(paragraphs.size());
+  for (size_t i = 0; i < paragraphs.size(); i++)
+    unilib::utf8::decode(paragraphs[i], decoded[i]);
+
+  cout << left << setw(45) << "benchmark" << right << setw(10) << "ops" << setw(12) << "min ns/op"
+       << setw(12) << "median" << setw(12) << "mean" << setw(12) << "stddev" << endl;
+
+  // NameTag components
+  benchmark("ner::recognize", words, [&]() {
+    vector<named_entity> entities;
+    size_t result = 0;
+    for (auto&& sentence : sentences)
+      recognizer->recognize(sentence, entities), result += entities.size();
+    return result;
+  });
+
+  benchmark("tagger::tag", words, [&]() {
+    ner_sentence sentence;
+    size_t result = 0;
+    for (auto&& forms : sentences)
+      tagger->tag(forms, sentence), result += sentence.size;
+    return result;
+  });
+
+  benchmark("feature_templates::process_sentence", words, [&]() {
+    size_t result = 0;
+    for (auto&& sentence : tagged) {
+      templates.process_sentence(sentence, buffer);
+      for (unsigned i = 0; i < sentence.size; i++)
+        result += sentence.features[i].size();
+    }
+    return result;
+  });
+
+  // Every feature processor separately, starting with the omnipresent feature
+  vector<string> processor_names;
+  templates.processor_names(processor_names);
+  for (unsigned processor = 0; processor < processor_names.size(); processor++)
+    benchmark("feature processor " + to_string(processor + 1) + " " + processor_names[processor], words, [&]() {
+      size_t result = 0;
+      for (auto&& sentence : tagged) {
+        for (unsigned i = 0; i < sentence.size; i++)
+          sentence.features[i].resize(1);
+        templates.process_sentence_processor(processor, sentence, buffer);
+        for (unsigned i = 0; i < sentence.size; i++)
+          result += sentence.features[i].size();
+      }
+      return result;
+    });
+
+  for (unsigned stage = 0; stage < networks.size(); stage++)
+    benchmark("network_classifier::classify stage " + to_string(stage + 1), words, [&]() {
+      vector<double> outcomes, network_buffer;
+      size_t result = 0;
+      for (auto&& sentence : tagged)
+        for (unsigned i = 0; i < sentence.size; i++) {
+          networks[stage].classify(sentence.features[i], outcomes, network_buffer);
+          result += outcomes[0] > 0.5;
+        }
+      return result;
+    });
+
+  benchmark("url_detector::detect", words, [&]() {
+    size_t result = 0;
+    for (auto&& forms : sentences)
+      for (auto&& form : forms)
+        result += url_detector::detect(form);
+    return result;
+  });
+
+  // Unicode processing, per character
+  size_t characters = 0;
+  for (auto&& paragraph : decoded)
+    characters += paragraph.size();
+
+  benchmark("utf8::decode", characters, [&]() {
+    size_t result = 0;
+    for (auto&& paragraph : paragraphs)
+      for (const char* str = paragraph.c_str(); *str; )
+        result += unilib::utf8::decode(str);
+    return result;
+  });
+
+  benchmark("uninorms::nfc", characters, [&]() {
+    u32string normalized;
+    size_t result = 0;
+    for (auto&& paragraph : decoded) {
+      normalized.assign(paragraph);
+      unilib::uninorms::nfc(normalized);
+      result += normalized.size();
+    }
+    return result;
+  });
+
+  // MorphoDiTa components, when its model is available
+  if (options.count("morphodita_tagger")) {
+    unique_ptr<morphodita::tagger> morphodita_tagger(morphodita::tagger::load(options["morphodita_tagger"].c_str()));
+    if (!morphodita_tagger) runtime_failure("Cannot load MorphoDiTa tagger from file '" << options["morphodita_tagger"] << "'!");
+    auto morpho = morphodita_tagger->get_morpho();
+
+    // Forms found in the dictionary, and the ones analyzed by the guesser
+    vector<string_piece> known, unknown;
+    vector<morphodita::tagged_lemma> lemmas;
+    for (auto&& forms : sentences)
+      for (auto&& form : forms)
+        (morpho->analyze(form, morphodita::morpho::NO_GUESSER, lemmas) >= 0 ? known : unknown).push_back(form);
+
+    benchmark("morpho::analyze dictionary", known.size(), [&]() {
+      size_t result = 0;
+      for (auto&& form : known)
+        morpho->analyze(form, morphodita::morpho::NO_GUESSER, lemmas), result += lemmas.size();
+      return result;
+    });
+
+    benchmark("morpho::analyze guesser", unknown.size(), [&]() {
+      size_t result = 0;
+      for (auto&& form : unknown)
+        morpho->analyze(form, morphodita::morpho::GUESSER, lemmas), result += lemmas.size();
+      return result;
+    });
+
+    benchmark("morphodita::tagger::tag", words, [&]() {
+      vector<morphodita::tagged_lemma> tags;
+      size_t result = 0;
+      for (auto&& forms : sentences)
+        morphodita_tagger->tag(forms, tags), result += tags.size();
+      return result;
+    });
+
+    // The feature_sequences::score is called by viterbi::tag for every
+    // considered tag sequence, so they can be measured only together, on
+    // sentences with morphological analyses already performed.
+    vector<vector<string_piece>> raw_sentences(sentences);
+    vector<vector<vector<morphodita::tagged_lemma>>> analyses(sentences.size());
+    for (size_t i = 0; i < sentences.size(); i++) {
+      analyses[i].resize(sentences[i].size());
+      for (size_t j = 0; j < sentences[i].size(); j++) {
+        raw_sentences[i][j].len = morpho->raw_form_len(sentences[i][j]);
+        morpho->analyze(sentences[i][j], morphodita::morpho::GUESSER, analyses[i][j]);
+      }
+    }
+
+    benchmark("feature_sequences::score+viterbi::tag", words, [&]() {
+      vector<int> tags;
+      size_t result = 0;
+      for (size_t i = 0; i < raw_sentences.size(); i++)
+        morphodita_tagger->tag_analyzed(raw_sentences[i], analyses[i], tags), result += tags.size();
+      return result;
+    });
+  }
+
+  return 0;
+}
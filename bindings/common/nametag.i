@@ -14,8 +14,22 @@
 %include "nametag_stl.i"
 
 %{
+#include <memory>
+
 #include "nametag.h"
 using namespace ufal::nametag;
+
+// Languages with a global interpreter lock can release it during
+// tokenization and recognition by defining these macros.
+#ifndef NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
+#define NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS {
+#define NAMETAG_BINDINGS_END_ALLOW_THREADS }
+#endif
+
+struct document_sentence {
+  std::vector<token_range> tokens;
+  std::vector<named_entity> entities;
+};
 %}
 
 %template(Ints) std::vector<int>;
@@ -44,6 +58,37 @@ struct named_entity {
 %template(NamedEntities) std::vector<named_entity>;
 typedef std::vector<named_entity> NamedEntities;
 
+%rename(NamedEntityId) named_entity_id;
+struct named_entity_id {
+  size_t start;
+  size_t length;
+  unsigned type;
+
+  named_entity_id() {}
+  named_entity_id(size_t start, size_t length, unsigned type) : start(start), length(length), type(type) {}
+};
+%template(NamedEntityIds) std::vector<named_entity_id>;
+typedef std::vector<named_entity_id> NamedEntityIds;
+
+%rename(EntitySpan) entity_span;
+struct entity_span {
+  size_t start;
+  size_t length;
+  size_t char_start;
+  size_t char_length;
+  std::string type;
+};
+%template(EntitySpans) std::vector<entity_span>;
+typedef std::vector<entity_span> EntitySpans;
+
+%rename(DocumentSentence) document_sentence;
+struct document_sentence {
+  std::vector<token_range> tokens;
+  std::vector<named_entity> entities;
+};
+%template(DocumentSentences) std::vector<document_sentence>;
+typedef std::vector<document_sentence> DocumentSentences;
+
 %rename(Version) version;
 class version {
  public:
@@ -69,13 +114,18 @@ class tokenizer {
 
     %rename(nextSentence) next_sentence;
     bool next_sentence(std::vector<std::string>* forms, std::vector<token_range>* tokens) {
-      if (!forms) return $self->next_sentence(NULL, tokens);
-
-      std::vector<string_piece> string_pieces;
-      bool result = $self->next_sentence(&string_pieces, tokens);
-      forms->resize(string_pieces.size());
-      for (unsigned i = 0; i < string_pieces.size(); i++)
-        forms->operator[](i).assign(string_pieces[i].str, string_pieces[i].len);
+      bool result;
+      NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
+      if (!forms) {
+        result = $self->next_sentence(NULL, tokens);
+      } else {
+        std::vector<string_piece> string_pieces;
+        result = $self->next_sentence(&string_pieces, tokens);
+        forms->resize(string_pieces.size());
+        for (unsigned i = 0; i < string_pieces.size(); i++)
+          forms->operator[](i).assign(string_pieces[i].str, string_pieces[i].len);
+      }
+      NAMETAG_BINDINGS_END_ALLOW_THREADS
       return result;
     }
   }
@@ -96,11 +146,64 @@ class ner {
 
   %extend {
     void recognize(const std::vector<std::string>& forms, std::vector<named_entity>& entities) const {
+      NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
       std::vector<string_piece> string_pieces;
       string_pieces.reserve(forms.size());
       for (auto&& form : forms)
         string_pieces.emplace_back(form);
       $self->recognize(string_pieces, entities);
+      NAMETAG_BINDINGS_END_ALLOW_THREADS
+    }
+
+    %rename(recognizeIds) recognize_ids;
+    void recognize_ids(const std::vector<std::string>& forms, std::vector<named_entity_id>& entities) const {
+      NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
+      std::vector<string_piece> string_pieces;
+      string_pieces.reserve(forms.size());
+      for (auto&& form : forms)
+        string_pieces.emplace_back(form);
+      $self->recognize_ids(string_pieces, entities);
+      NAMETAG_BINDINGS_END_ALLOW_THREADS
+    }
+
+    %rename(recognizeText) recognize_text;
+    bool recognize_text(const char* text, std::vector<entity_span>& entities) const {
+      bool result;
+      NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
+      result = $self->recognize_text(text, entities);
+      NAMETAG_BINDINGS_END_ALLOW_THREADS
+      return result;
+    }
+
+    // Tokenize the whole document using new_tokenizer and recognize all its
+    // sentences at once. Token ranges are offsets in the document, entities
+    // are indices of the tokens of the sentence. Returns false when the
+    // recognizer has no tokenizer.
+    %rename(recognizeDocument) recognize_document;
+    bool recognize_document(const char* text, std::vector<document_sentence>& sentences) const {
+      sentences.clear();
+
+      std::unique_ptr<tokenizer> document_tokenizer($self->new_tokenizer());
+      if (!document_tokenizer) return false;
+
+      NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS
+      std::vector<std::vector<string_piece>> forms;
+      std::vector<string_piece> sentence_forms;
+      std::vector<token_range> sentence_tokens;
+      document_tokenizer->set_text(text, false);
+      while (document_tokenizer->next_sentence(&sentence_forms, &sentence_tokens)) {
+        forms.push_back(sentence_forms);
+        sentences.emplace_back();
+        sentences.back().tokens.swap(sentence_tokens);
+      }
+
+      std::vector<std::vector<named_entity>> entities;
+      $self->recognize_batch(forms, entities);
+      for (unsigned i = 0; i < sentences.size() && i < entities.size(); i++)
+        sentences[i].entities.swap(entities[i]);
+      NAMETAG_BINDINGS_END_ALLOW_THREADS
+
+      return true;
     }
   }
 
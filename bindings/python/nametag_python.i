@@ -1,3 +1,9 @@
 %module(package="ufal") nametag
 
+%{
+// Release the GIL during tokenization and recognition.
+#define NAMETAG_BINDINGS_BEGIN_ALLOW_THREADS Py_BEGIN_ALLOW_THREADS
+#define NAMETAG_BINDINGS_END_ALLOW_THREADS Py_END_ALLOW_THREADS
+%}
+
 %include "../common/nametag.i"
@@ -0,0 +1,265 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include "ner/allocation_counter.h"
+#include "ner/bilou_ner.h"
+#include "ner/recognition_observer.h"
+#include "utils/getpara.h"
+#include "utils/iostreams.h"
+#include "utils/options.h"
+#include "utils/parse_int.h"
+#include "utils/path_from_utf8.h"
+#include "utils/peak_rss.h"
+#include "version/version.h"
+
+using namespace ufal::nametag;
+
+// Recognition stage times, gathered from all threads
+class stage_times : public recognition_observer {
+ public:
+  enum { TOKENIZATION = recognition_observer::STAGES_TOTAL, STAGES_TOTAL, NETWORKS_MAX = 16 };
+
+  stage_times() {
+    for (auto&& stage : nanoseconds)
+      for (auto&& network : stage)
+        network.store(0, memory_order_relaxed);
+  }
+
+  virtual void stage_finished(recognition_observer::stage_t stage, unsigned network, double seconds) override {
+    add(stage, network, seconds);
+  }
+
+  void add(int stage, unsigned network, double seconds) {
+    nanoseconds[stage][network < NETWORKS_MAX ? network : NETWORKS_MAX - 1].fetch_add(uint64_t(seconds * 1e9), memory_order_relaxed);
+  }
+
+  double seconds(int stage, unsigned network) const {
+    return nanoseconds[stage][network].load(memory_order_relaxed) / 1e9;
+  }
+
+ private:
+  atomic<uint64_t> nanoseconds[STAGES_TOTAL][NETWORKS_MAX];
+};
+
+static void generate_corpus(const vector<string>& vocabulary, unsigned sentences, vector<string>& corpus);
+static void benchmark(const ner& recognizer, bool vertical, const vector<string>& corpus, unsigned threads, unsigned repeat, ostream& json);
+static string json_string(const string& str);
+
+int main(int argc, char* argv[]) {
+  iostreams_init();
+
+  options::map options;
+  if (!options::parse({{"input", options::value{"untokenized", "vertical"}},
+                       {"threads", options::value::any},
+                       {"repeat", options::value::any},
+                       {"synthetic", options::value::any},
+                       {"version", options::value::none},
+                       {"help", options::value::none}}, argc, argv, options) ||
+      options.count("help") ||
+      ((argc < 2 || argc > 3) && !options.count("version")))
+    runtime_failure("Usage: " << argv[0] << " [options] recognizer_model [corpus_file]\n"
+                    "Options: --input=untokenized|vertical\n"
+                    "         --threads=maximum number of threads, all counts from 1 are measured (default 1)\n"
+                    "         --repeat=number of passes over the corpus (default 1)\n"
+                    "         --synthetic=number of sentences generated when no corpus is given (default 10000)\n"
+                    "         --version\n"
+                    "         --help");
+  if (options.count("version"))
+    return cout << version::version_and_copyright() << endl, 0;
+
+  int threads = options.count("threads") ? parse_int(options["threads"], "number of threads") : 1;
+  if (threads < 1) runtime_failure("The number of threads must be positive!");
+  int repeat = options.count("repeat") ? parse_int(options["repeat"], "number of passes") : 1;
+  if (repeat < 1) runtime_failure("The number of passes must be positive!");
+  int synthetic = options.count("synthetic") ? parse_int(options["synthetic"], "number of synthetic sentences") : 10000;
+  if (synthetic < 1) runtime_failure("The number of synthetic sentences must be positive!");
+
+  cerr << "Loading ner: ";
+  auto start = chrono::steady_clock::now();
+  unique_ptr<ner> recognizer(ner::load(argv[1]));
+  if (!recognizer) runtime_failure("Cannot load ner from file '" << argv[1] << "'!");
+  double load_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cerr << "done" << endl;
+
+  // Load the corpus, or generate it from the model vocabulary
+  vector<string> corpus;
+  bool vertical = options.count("input") && options["input"] == "vertical";
+  if (argc == 3) {
+    ifstream corpus_file(path_from_utf8(argv[2]).c_str());
+    if (!corpus_file.is_open()) runtime_failure("Cannot open corpus file '" << argv[2] << "'!");
+    for (string para; getpara(corpus_file, para); )
+      corpus.push_back(para);
+  } else {
+    vector<string> vocabulary;
+    auto bilou_recognizer = dynamic_cast<const bilou_ner*>(recognizer.get());
+    if (bilou_recognizer) bilou_recognizer->vocabulary(vocabulary);
+    vocabulary.erase(remove_if(vocabulary.begin(), vocabulary.end(), [](const string& form) {
+      return form.empty() || form.find_first_of("\r\n") != string::npos;
+    }), vocabulary.end());
+    if (vocabulary.empty()) runtime_failure("The model has no vocabulary to generate a synthetic corpus from, please supply a corpus!");
+    generate_corpus(vocabulary, synthetic, corpus);
+    vertical = true;
+  }
+
+  cout << "{\"model\":" << json_string(argv[1]) << ",\"corpus\":" << json_string(argc == 3 ? argv[2] : "synthetic") << ","
+       << "\"load_seconds\":" << load_time << ",\"runs\":[";
+  for (int run_threads = 1; run_threads <= threads; run_threads++) {
+    if (run_threads > 1) cout << ',';
+    benchmark(*recognizer, vertical, corpus, run_threads, repeat, cout);
+  }
+  cout << "],\"peak_rss_kb\":" << peak_rss_kb();
+
+  // Profiling statistics, available when compiled with NAMETAG_PROFILING
+  vector<recognition_statistics> statistics;
+  recognizer->statistics(statistics);
+  if (!statistics.empty()) {
+    cout << ",\"profile\":{";
+    for (size_t i = 0; i < statistics.size(); i++)
+      cout << (i ? "," : "") << json_string(statistics[i].name) << ":{\"calls\":" << statistics[i].calls << ",\"ticks\":" << statistics[i].ticks << '}';
+    cout << '}';
+  }
+  cout << '}' << endl;
+
+  return 0;
+}
+
+void generate_corpus(const vector<string>& vocabulary, unsigned sentences, vector<string>& corpus) {
+  mt19937 generator(42);
+  uniform_int_distribution<size_t> word(0, vocabulary.size() - 1);
+  uniform_int_distribution<unsigned> length(5, 25);
+
+  // The corpus is generated in the vertical format, so that every generated
+  // sentence is recognized as exactly one sentence.
+  corpus.clear();
+  for (unsigned s = 0; s < sentences; s++) {
+    if (s % 10 == 0) corpus.emplace_back();
+
+    for (unsigned i = length(generator); i; i--)
+      corpus.back().append(vocabulary[word(generator)]).push_back('\n');
+    corpus.back().append(".\n\n");
+  }
+}
+
+void benchmark(const ner& recognizer, bool vertical, const vector<string>& corpus, unsigned threads, unsigned repeat, ostream& json) {
+  stage_times times;
+  recognition_allocations stage_allocations(&times);
+  atomic<uint64_t> sentences(0), tokens(0), allocations(0), allocated_bytes(0), tokenization_allocations(0), tokenization_bytes(0);
+
+  // Every thread processes every threads-th paragraph of the corpus
+  auto start = chrono::steady_clock::now();
+  vector<thread> workers;
+  for (unsigned t = 0; t < threads; t++)
+    workers.emplace_back([&, t]() {
+      unique_ptr<tokenizer> tokenizer(vertical ? tokenizer::new_vertical_tokenizer() : recognizer.new_tokenizer());
+      if (!tokenizer) runtime_failure("No tokenizer is defined for the supplied model!");
+      recognition_observer::current() = &stage_allocations;
+
+      vector<string_piece> forms;
+      vector<named_entity> entities;
+      uint64_t thread_sentences = 0, thread_tokens = 0;
+      auto& thread_allocations = allocation_counter::current();
+      auto initial_allocations = thread_allocations, tokenization_allocations_start = thread_allocations;
+      allocation_counter::counts thread_tokenization_allocations = {0, 0};
+      for (unsigned pass = 0; pass < repeat; pass++)
+        for (size_t i = t; i < corpus.size(); i += threads) {
+          auto tokenization_start = chrono::steady_clock::now();
+          tokenization_allocations_start = thread_allocations;
+          tokenizer->set_text(corpus[i]);
+          while (tokenizer->next_sentence(&forms, nullptr)) {
+            thread_tokenization_allocations.allocations += thread_allocations.allocations - tokenization_allocations_start.allocations;
+            thread_tokenization_allocations.bytes += thread_allocations.bytes - tokenization_allocations_start.bytes;
+            auto tokenization_end = chrono::steady_clock::now();
+            times.add(stage_times::TOKENIZATION, 0, chrono::duration<double>(tokenization_end - tokenization_start).count());
+
+            recognizer.recognize(forms, entities);
+            thread_sentences++;
+            thread_tokens += forms.size();
+            tokenization_start = chrono::steady_clock::now();
+            tokenization_allocations_start = thread_allocations;
+          }
+          thread_tokenization_allocations.allocations += thread_allocations.allocations - tokenization_allocations_start.allocations;
+          thread_tokenization_allocations.bytes += thread_allocations.bytes - tokenization_allocations_start.bytes;
+          times.add(stage_times::TOKENIZATION, 0, chrono::duration<double>(chrono::steady_clock::now() - tokenization_start).count());
+        }
+
+      recognition_observer::current() = nullptr;
+      sentences.fetch_add(thread_sentences);
+      tokens.fetch_add(thread_tokens);
+      allocations.fetch_add(thread_allocations.allocations - initial_allocations.allocations);
+      allocated_bytes.fetch_add(thread_allocations.bytes - initial_allocations.bytes);
+      tokenization_allocations.fetch_add(thread_tokenization_allocations.allocations);
+      tokenization_bytes.fetch_add(thread_tokenization_allocations.bytes);
+    });
+  for (auto&& worker : workers)
+    worker.join();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  // Gather the stages
+  static const char* stage_names[] = {"tagging", "features", "classification", "decoding", "entities", "tokenization"};
+  struct stage_info {
+    string name;
+    double seconds;
+    allocation_counter::counts allocations;
+  };
+  vector<stage_info> stages;
+  for (int stage = 0; stage < stage_times::STAGES_TOTAL; stage++)
+    for (unsigned network = 0; network < stage_times::NETWORKS_MAX; network++) {
+      bool per_network = stage == recognition_observer::FEATURES || stage == recognition_observer::CLASSIFICATION || stage == recognition_observer::DECODING;
+      if (network && !per_network) break;
+      double stage_seconds = times.seconds(stage, network);
+      if (per_network && !stage_seconds) continue;
+      allocation_counter::counts stage_allocations_counts = {tokenization_allocations.load(), tokenization_bytes.load()};
+      if (stage < recognition_observer::STAGES_TOTAL) stage_allocations_counts = stage_allocations.stage(recognition_observer::stage_t(stage), network);
+      stages.push_back({string(stage_names[stage]).append(per_network ? "_" + to_string(network + 1) : string()), stage_seconds, stage_allocations_counts});
+    }
+  double stages_seconds = 0;
+  for (auto&& stage : stages)
+    stages_seconds += stage.seconds;
+
+  json << "{\"threads\":" << threads << ",\"seconds\":" << seconds
+       << ",\"sentences\":" << sentences.load() << ",\"tokens\":" << tokens.load()
+       << ",\"sentences_per_second\":" << sentences.load() / seconds << ",\"tokens_per_second\":" << tokens.load() / seconds
+       << ",\"allocations\":" << allocations.load() << ",\"allocated_bytes\":" << allocated_bytes.load()
+       << ",\"allocations_per_sentence\":" << allocations.load() / double(sentences.load() ? sentences.load() : 1)
+       << ",\"stages\":{";
+  for (size_t i = 0; i < stages.size(); i++)
+    json << (i ? "," : "") << '"' << stages[i].name << "\":{\"seconds\":" << stages[i].seconds
+         << ",\"share\":" << (stages_seconds ? stages[i].seconds / stages_seconds : 0.)
+         << ",\"allocations_per_sentence\":" << stages[i].allocations.allocations / double(sentences.load() ? sentences.load() : 1)
+         << ",\"bytes_per_sentence\":" << stages[i].allocations.bytes / double(sentences.load() ? sentences.load() : 1) << '}';
+  json << "}}";
+
+  cerr << threads << " thread(s): " << fixed << setprecision(0) << tokens.load() / seconds << " tokens/s, "
+       << sentences.load() / seconds << " sentences/s, " << setprecision(2)
+       << allocations.load() / double(sentences.load() ? sentences.load() : 1) << " allocations/sentence";
+  for (auto&& stage : stages)
+    cerr << ", " << stage.name << ' ' << setprecision(1) << (stages_seconds ? 100 * stage.seconds / stages_seconds : 0.) << '%';
+  cerr << endl;
+  cerr.unsetf(ios::floatfield);
+  cerr << setprecision(6);
+}
+
+string json_string(const string& str) {
+  string quoted(1, '"');
+  for (auto&& chr : str)
+    if (chr == '"' || chr == '\\')
+      quoted.append(1, '\\').append(1, chr);
+    else if ((unsigned char) chr < 0x20)
+      quoted.append("\\u00").append(1, "0123456789abcdef"[chr >> 4]).append(1, "0123456789abcdef"[chr & 15]);
+    else
+      quoted.push_back(chr);
+  return quoted.append(1, '"');
+}
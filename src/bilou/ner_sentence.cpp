@@ -18,6 +18,7 @@ void ner_sentence::resize(unsigned size) {
   this->size = size;
   if (words.size() < size) words.resize(size);
   if (features.size() < size) features.resize(size);
+  if (stage_independent_features.size() < size) stage_independent_features.resize(size);
   if (probabilities.size() < size) probabilities.resize(size);
   if (previous_stage.size() < size) previous_stage.resize(size);
 }
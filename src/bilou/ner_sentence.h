@@ -21,6 +21,7 @@ struct ner_sentence {
   unsigned size = 0;
   vector<ner_word> words;
   vector<ner_features> features;
+  vector<unsigned> stage_independent_features;
 
   struct probability_info {
     bilou_probabilities local;
@@ -0,0 +1,143 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "common.h"
+#include "classifier_feature.h"
+#include "classifier_outcome.h"
+
+namespace ufal {
+namespace nametag {
+
+//
+// Declarations
+//
+
+// Training instances provided in blocks, which can be processed in any order.
+// The returned block is either owned by the source, or read into the buffer.
+class classifier_instances;
+class classifier_instances_source {
+ public:
+  virtual ~classifier_instances_source() {}
+
+  virtual size_t blocks() const = 0;
+  virtual const classifier_instances* block(size_t index, classifier_instances& buffer) const = 0;
+};
+
+// Compact storage of classifier training instances. The features of all
+// instances are stored in one array, with every feature stored as a zigzag
+// encoded difference from the previous feature of the instance, using 15 bits
+// in every 16-bit unit. Most features therefore occupy 16 or 32 bits.
+class classifier_instances : public classifier_instances_source {
+ public:
+  inline size_t size() const { return outcomes.size(); }
+  inline bool empty() const { return outcomes.empty(); }
+  inline void clear();
+
+  inline void add(const classifier_features& features, classifier_outcome outcome);
+  inline void append(const classifier_instances& other);
+
+  inline classifier_outcome outcome(size_t instance) const { return outcomes[instance]; }
+  inline void features(size_t instance, classifier_features& features) const;
+
+  // Number of bytes used by the stored instances.
+  inline size_t memory() const;
+
+  // Binary serialization in native byte order, for temporary files only.
+  inline void save(ostream& os) const;
+  inline bool load(istream& is);
+
+  // The instances form a single block.
+  virtual size_t blocks() const override { return 1; }
+  virtual const classifier_instances* block(size_t /*index*/, classifier_instances& /*buffer*/) const override { return this; }
+
+ private:
+  vector<uint16_t> data;
+  vector<size_t> offsets = vector<size_t>(1, 0);
+  vector<classifier_outcome> outcomes;
+};
+
+//
+// Definitions
+//
+
+void classifier_instances::clear() {
+  data.clear();
+  offsets.assign(1, 0);
+  outcomes.clear();
+}
+
+void classifier_instances::add(const classifier_features& features, classifier_outcome outcome) {
+  classifier_feature previous = 0;
+  for (auto&& feature : features) {
+    uint32_t delta = feature - previous;
+    uint32_t value = (delta << 1) ^ uint32_t(-int32_t(delta >> 31));
+    previous = feature;
+
+    for (; value >= 0x8000; value >>= 15)
+      data.push_back(uint16_t(0x8000 | (value & 0x7FFF)));
+    data.push_back(uint16_t(value));
+  }
+
+  offsets.push_back(data.size());
+  outcomes.push_back(outcome);
+}
+
+void classifier_instances::append(const classifier_instances& other) {
+  size_t base = data.size();
+  data.insert(data.end(), other.data.begin(), other.data.end());
+  for (size_t i = 1; i < other.offsets.size(); i++)
+    offsets.push_back(base + other.offsets[i]);
+  outcomes.insert(outcomes.end(), other.outcomes.begin(), other.outcomes.end());
+}
+
+void classifier_instances::features(size_t instance, classifier_features& features) const {
+  features.clear();
+
+  classifier_feature previous = 0;
+  for (const uint16_t* it = data.data() + offsets[instance], *end = data.data() + offsets[instance + 1]; it < end; ) {
+    uint32_t value = 0;
+    for (unsigned shift = 0; ; shift += 15) {
+      value |= uint32_t(*it & 0x7FFF) << shift;
+      if (!(*it++ & 0x8000)) break;
+    }
+
+    previous += (value >> 1) ^ uint32_t(-int32_t(value & 1));
+    features.push_back(previous);
+  }
+}
+
+size_t classifier_instances::memory() const {
+  return data.size() * sizeof(uint16_t) + offsets.size() * sizeof(size_t) + outcomes.size() * sizeof(classifier_outcome);
+}
+
+void classifier_instances::save(ostream& os) const {
+  uint64_t sizes[2] = {outcomes.size(), data.size()};
+  os.write((const char*) sizes, sizeof(sizes));
+  os.write((const char*) data.data(), data.size() * sizeof(uint16_t));
+  os.write((const char*) offsets.data(), offsets.size() * sizeof(size_t));
+  os.write((const char*) outcomes.data(), outcomes.size() * sizeof(classifier_outcome));
+}
+
+bool classifier_instances::load(istream& is) {
+  uint64_t sizes[2];
+  if (!is.read((char*) sizes, sizeof(sizes))) return false;
+
+  data.resize(sizes[1]);
+  offsets.resize(sizes[0] + 1);
+  outcomes.resize(sizes[0]);
+  is.read((char*) data.data(), data.size() * sizeof(uint16_t));
+  is.read((char*) offsets.data(), offsets.size() * sizeof(size_t));
+  is.read((char*) outcomes.data(), outcomes.size() * sizeof(classifier_outcome));
+  return bool(is);
+}
+
+} // namespace nametag
+} // namespace ufal
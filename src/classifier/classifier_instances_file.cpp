@@ -0,0 +1,57 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "classifier_instances_file.h"
+#include "utils/path_from_utf8.h"
+
+namespace ufal {
+namespace nametag {
+
+classifier_instances_file::~classifier_instances_file() {
+  if (writer.is_open()) writer.close();
+  if (!path.empty()) remove_utf8(path);
+}
+
+bool classifier_instances_file::create(const string& path) {
+  this->path = path;
+  offsets.clear();
+  instances = 0;
+
+  writer.open(path_from_utf8(path).c_str(), ofstream::binary | ofstream::trunc);
+  return writer.is_open();
+}
+
+bool classifier_instances_file::add_block(const classifier_instances& instances) {
+  if (instances.empty()) return true;
+
+  offsets.push_back(writer.tellp());
+  instances.save(writer);
+  this->instances += instances.size();
+  return bool(writer);
+}
+
+bool classifier_instances_file::finish() {
+  writer.close();
+  return !writer.fail();
+}
+
+size_t classifier_instances_file::blocks() const {
+  return offsets.size();
+}
+
+const classifier_instances* classifier_instances_file::block(size_t index, classifier_instances& buffer) const {
+  if (index >= offsets.size()) return nullptr;
+
+  ifstream reader(path_from_utf8(path).c_str(), ifstream::binary);
+  if (!reader.seekg(offsets[index])) return nullptr;
+  return buffer.load(reader) ? &buffer : nullptr;
+}
+
+} // namespace nametag
+} // namespace ufal
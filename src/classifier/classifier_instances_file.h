@@ -0,0 +1,44 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <fstream>
+
+#include "common.h"
+#include "classifier_instances.h"
+
+namespace ufal {
+namespace nametag {
+
+// Training instances spilled to a temporary file in blocks, so that they do
+// not need to fit in memory. The blocks can be read from several threads
+// concurrently. The file is removed when the object is destroyed.
+class classifier_instances_file : public classifier_instances_source {
+ public:
+  ~classifier_instances_file();
+
+  bool create(const string& path);
+  bool add_block(const classifier_instances& instances);
+  bool finish();
+
+  size_t size() const { return instances; }
+
+  virtual size_t blocks() const override;
+  virtual const classifier_instances* block(size_t index, classifier_instances& buffer) const override;
+
+ private:
+  string path;
+  ofstream writer;
+  vector<uint64_t> offsets;
+  size_t instances = 0;
+};
+
+} // namespace nametag
+} // namespace ufal
@@ -8,12 +8,18 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <future>
 #include <random>
 
 #include "network_classifier.h"
+#include "ner/memory_footprint.h"
 #include "utils/compressor.h"
+#include "utils/parallel_for.h"
 #include "utils/unaligned_access.h"
 
 namespace ufal {
@@ -39,9 +45,23 @@ bool network_classifier::load(istream& is) {
     }
 
     // Output layer
-    unsigned outcomes = data.next_2B();
-    output_layer.resize(outcomes);
-    output_error.resize(outcomes);
+    output_layer.resize(data.next_2B());
+
+    // Optional quantized direct connections
+    quantized_weights.clear();
+    quantized_scales.clear();
+    if (!data.is_end()) {
+      if (data.next_1B() != QUANTIZED_INT8) return false;
+
+      quantized_scales.resize(data.next_4B());
+      if (!quantized_scales.empty())
+        memcpy((unsigned char*) quantized_scales.data(), data.next<float>(quantized_scales.size()), quantized_scales.size() * sizeof(float));
+      load_matrix(data, quantized_weights);
+
+      if (quantized_scales.size() != indices.size() || quantized_weights.size() != indices.size()) return false;
+      for (unsigned f = 0; f < indices.size(); f++)
+        if (quantized_weights[f].size() != indices[f].size()) return false;
+    }
   } catch (binary_decoder_error&) {
     return false;
   }
@@ -59,30 +79,41 @@ void network_classifier::load_matrix(binary_decoder& data, vector<vector<T>>& m)
   }
 }
 
-bool network_classifier::train(unsigned features, unsigned outcomes, const vector<classifier_instance>& train,
-                               const vector<classifier_instance>& heldout, const network_parameters& parameters, bool verbose) {
+bool network_classifier::train(unsigned features, unsigned outcomes, const classifier_instances_source& train,
+                               const classifier_instances& heldout, const network_parameters& parameters, bool verbose) {
   // Assertions
   if (features <= 0) { if (verbose) cerr << "There must be more than zero features!" << endl; return false; }
   if (outcomes <= 0) { if (verbose) cerr << "There must be more than zero features!" << endl; return false; }
-  if (train.empty()) { if (verbose) cerr << "No training data!" << endl; return false; }
-  for (auto&& instance : train) {
-    if (instance.outcome >= outcomes) { if (verbose) cerr << "Training instances out of range!" << endl; return false; }
-    for(auto& feature : instance.features)
-      if (feature >= features) { if (verbose) cerr << "Training instances out of range!" << endl; return false; }
-  }
-  for (auto&& instance : heldout)
-    for(auto& feature : instance.features)
+  classifier_features instance_features;
+  for (size_t i = 0; i < heldout.size(); i++) {
+    heldout.features(i, instance_features);
+    for(auto& feature : instance_features)
       if (feature >= features) { if (verbose) cerr << "Heldout instances out of range!" << endl; return false; }
+  }
 
   mt19937 generator(42);
   uniform_real_distribution<float> uniform(-0.1f, 0.1f);
 
-  // Compute indices from existing feature-outcome pairs
+  // Compute indices from existing feature-outcome pairs, checking the training data
   indices.clear();
   indices.resize(features);
-  for (auto&& instance : train)
-    for (auto&& feature : instance.features)
-      indices[feature].emplace_back(instance.outcome);
+  size_t train_size = 0;
+  classifier_instances buffers[2];
+  for (size_t b = 0; b < train.blocks(); b++) {
+    auto block = train.block(b, buffers[0]);
+    if (!block) { if (verbose) cerr << "Cannot read training instances!" << endl; return false; }
+
+    for (size_t i = 0; i < block->size(); i++) {
+      if (block->outcome(i) >= outcomes) { if (verbose) cerr << "Training instances out of range!" << endl; return false; }
+      block->features(i, instance_features);
+      for (auto&& feature : instance_features) {
+        if (feature >= features) { if (verbose) cerr << "Training instances out of range!" << endl; return false; }
+        indices[feature].emplace_back(block->outcome(i));
+      }
+    }
+    train_size += block->size();
+  }
+  if (!train_size) { if (verbose) cerr << "No training data!" << endl; return false; }
 
   for (auto&& row : indices) {
     sort(row.begin(), row.end());
@@ -90,6 +121,8 @@ bool network_classifier::train(unsigned features, unsigned outcomes, const vecto
   }
 
   // Initialize direct connections
+  quantized_weights.clear();
+  quantized_scales.clear();
   weights.clear();
   for (auto&& row : indices)
     weights.emplace_back(row.size());
@@ -98,8 +131,6 @@ bool network_classifier::train(unsigned features, unsigned outcomes, const vecto
   // Initialize hidden layer
   hidden_layer.resize(parameters.hidden_layer);
   if (!hidden_layer.empty()) {
-    hidden_error.resize(hidden_layer.size());
-
     hidden_weights[0].resize(features);
     for (auto&& row : hidden_weights[0])
       for (auto&& weight : row.resize(hidden_layer.size()), row)
@@ -113,18 +144,27 @@ bool network_classifier::train(unsigned features, unsigned outcomes, const vecto
 
   // Initialize output layer
   output_layer.resize(outcomes);
-  output_error.resize(outcomes);
 
   // Normalize gaussian_sigma
-  double gaussian_sigma = parameters.gaussian_sigma / train.size();
+  double gaussian_sigma = parameters.gaussian_sigma / train_size;
 
   // Train
+  vector<size_t> blocks;
+  for (size_t b = 0; b < train.blocks(); b++)
+    blocks.push_back(b);
   vector<int> permutation;
-  for (unsigned i = 0; i < train.size(); i++)
-    permutation.push_back(i);
+
+  unsigned threads = parameters.threads > 1 ? parameters.threads : 1;
+  const size_t chunk_size = 1024;
+
+  // With early stopping, the weights with the best heldout accuracy are kept
+  bool early_stopping = parameters.early_stopping > 0 && !heldout.empty();
+  vector<vector<float>> best_weights, best_hidden_weights[2];
+  int best_heldout_correct = -1, best_iteration = 0;
 
   for (int iteration = 0; iteration < parameters.iterations; iteration++) {
     if (verbose) cerr << "Iteration " << iteration + 1 << ": ";
+    auto iteration_start = chrono::steady_clock::now();
 
     double learning_rate = parameters.final_learning_rate && parameters.iterations > 1 ?
         exp(((parameters.iterations - 1 - iteration) * log(parameters.initial_learning_rate) + iteration * log(parameters.final_learning_rate)) / (parameters.iterations-1)) :
@@ -132,35 +172,108 @@ bool network_classifier::train(unsigned features, unsigned outcomes, const vecto
     double logprob = 0;
     int training_correct = 0;
 
-    // Process instances in random order
-    shuffle(permutation.begin(), permutation.end(), generator);
-    for (auto&& train_index : permutation) {
-      auto& instance = train[train_index];
-      propagate(instance.features);
-
-      // Update logprob and training_correct
-      logprob += log(output_layer[instance.outcome]);
-      training_correct += best_outcome() == instance.outcome;
-
-      // Improve network weights according to correct outcome
-      backpropagate(instance, learning_rate, gaussian_sigma);
+    // Process the blocks in random order, reading the next block in the
+    // background while the current one is being processed.
+    if (blocks.size() > 1) shuffle(blocks.begin(), blocks.end(), generator);
+    auto read_block = [&](size_t b) {
+      return async(blocks.size() > 1 ? launch::async : launch::deferred, [&train, &blocks, &buffers, b] {
+        return train.block(blocks[b], buffers[b & 1]);
+      });
+    };
+    auto next_block = read_block(0);
+    for (size_t b = 0; b < blocks.size(); b++) {
+      auto block = next_block.get();
+      if (!block) { if (verbose) cerr << "Cannot read training instances!" << endl; return false; }
+      if (b + 1 < blocks.size()) next_block = read_block(b + 1);
+      auto& instances = *block;
+
+      // Process instances of the block in random order
+      if (permutation.size() != instances.size()) {
+        permutation.clear();
+        for (unsigned i = 0; i < instances.size(); i++)
+          permutation.push_back(i);
+      }
+      shuffle(permutation.begin(), permutation.end(), generator);
+      if (threads == 1) {
+        workspace w(hidden_layer.size(), outcomes);
+        for (auto&& train_index : permutation) {
+          auto outcome = instances.outcome(train_index);
+          instances.features(train_index, w.features);
+          propagate(w.features, w.hidden_layer, w.output_layer);
+
+          // Update logprob and training_correct
+          logprob += log(w.output_layer[outcome]);
+          training_correct += best_outcome(w.output_layer) == outcome;
+
+          // Improve network weights according to correct outcome
+          backpropagate(w.features, outcome, learning_rate, gaussian_sigma, w);
+        }
+      } else {
+        // Hogwild-style training -- the threads update the weights without any
+        // locking, relying on the sparsity of the features to avoid collisions.
+        vector<double> chunk_logprob((permutation.size() + chunk_size - 1) / chunk_size);
+        atomic<int> chunk_correct(0);
+        parallel_for(permutation.size(), chunk_size, threads, [&](size_t begin, size_t end) {
+          workspace w(hidden_layer.size(), outcomes);
+          int correct = 0;
+          for (size_t i = begin; i < end; i++) {
+            auto outcome = instances.outcome(permutation[i]);
+            instances.features(permutation[i], w.features);
+            propagate(w.features, w.hidden_layer, w.output_layer);
+            chunk_logprob[begin / chunk_size] += log(w.output_layer[outcome]);
+            correct += best_outcome(w.output_layer) == outcome;
+            backpropagate(w.features, outcome, learning_rate, gaussian_sigma, w);
+          }
+          chunk_correct += correct;
+        });
+        for (auto&& chunk : chunk_logprob)
+          logprob += chunk;
+        training_correct += chunk_correct;
+      }
     }
     if (verbose)
       cerr << "a " << fixed << setprecision(3) << learning_rate
            << ", logprob " << scientific << setprecision(4) << logprob
-           << ", training acc " << fixed << setprecision(2) << training_correct * 100. / train.size()
+           << ", training acc " << fixed << setprecision(2) << training_correct * 100. / train_size
            << "%, ";
 
     // Evaluate heldout accuracy if heldout data are present
     if (!heldout.empty()) {
-      int heldout_correct = 0;
-      for (auto&& instance : heldout) {
-        propagate(instance.features);
-        heldout_correct += best_outcome() == instance.outcome;
-      }
+      atomic<int> heldout_correct(0);
+      parallel_for(heldout.size(), chunk_size, threads, [&](size_t begin, size_t end) {
+        workspace w(hidden_layer.size(), outcomes);
+        int correct = 0;
+        for (size_t i = begin; i < end; i++) {
+          heldout.features(i, w.features);
+          propagate(w.features, w.hidden_layer, w.output_layer);
+          correct += best_outcome(w.output_layer) == heldout.outcome(i);
+        }
+        heldout_correct += correct;
+      });
       if (verbose) cerr << "heldout acc " << heldout_correct * 100. / heldout.size() << ", ";
+
+      if (early_stopping && heldout_correct > best_heldout_correct) {
+        best_heldout_correct = heldout_correct;
+        best_iteration = iteration;
+        best_weights = weights;
+        best_hidden_weights[0] = hidden_weights[0];
+        best_hidden_weights[1] = hidden_weights[1];
+      }
+    }
+    if (verbose) cerr << "done in " << fixed << setprecision(2) << chrono::duration<double>(chrono::steady_clock::now() - iteration_start).count() << "s." << endl;
+
+    if (early_stopping && iteration - best_iteration >= parameters.early_stopping) {
+      if (verbose) cerr << "No heldout improvement in " << parameters.early_stopping << " iterations, stopping." << endl;
+      break;
     }
-    if (verbose) cerr << "done." << endl;
+  }
+
+  // Restore the weights with the best heldout accuracy
+  if (early_stopping) {
+    if (verbose) cerr << "Using weights from iteration " << best_iteration + 1 << " with the best heldout accuracy." << endl;
+    weights.swap(best_weights);
+    hidden_weights[0].swap(best_hidden_weights[0]);
+    hidden_weights[1].swap(best_hidden_weights[1]);
   }
   return true;
 }
@@ -173,18 +286,61 @@ void network_classifier::classify(const classifier_features& features, vector<do
   propagate(features, buffer, outcomes);
 }
 
-void network_classifier::propagate(const classifier_features& features) {
-  propagate(features, hidden_layer, output_layer);
+double network_classifier::accuracy(const classifier_instances& instances) const {
+  if (instances.empty()) return 0.;
+
+  workspace w(hidden_layer.size(), output_layer.size());
+  size_t correct = 0;
+  for (size_t i = 0; i < instances.size(); i++) {
+    instances.features(i, w.features);
+    propagate(w.features, w.hidden_layer, w.output_layer);
+    correct += best_outcome(w.output_layer) == instances.outcome(i);
+  }
+  return correct / double(instances.size());
+}
+
+bool network_classifier::quantized() const {
+  return !quantized_weights.empty();
+}
+
+size_t network_classifier::weights_count() const {
+  size_t count = 0;
+  for (auto&& row : indices)
+    count += row.size();
+  return count;
+}
+
+void network_classifier::memory_footprint(const string& name, vector<memory_component>& components) const {
+  size_t stored = weights_count(), dense = indices.size() * output_layer.size();
+  char details[128];
+  snprintf(details, sizeof(details), "%zu features x %zu outcomes, %.2f%% stored%s", indices.size(), output_layer.size(),
+           dense ? 100. * stored / dense : 0., quantized() ? ", int8" : "");
+
+  components.emplace_back(name + " weights", ufal::nametag::memory_footprint(weights) + ufal::nametag::memory_footprint(quantized_weights) +
+                          ufal::nametag::memory_footprint(quantized_scales), stored, details);
+  components.emplace_back(name + " indices", ufal::nametag::memory_footprint(indices), indices.size());
+  if (!hidden_weights[0].empty())
+    components.emplace_back(name + " hidden layer", ufal::nametag::memory_footprint(hidden_weights[0]) + ufal::nametag::memory_footprint(hidden_weights[1]),
+                            hidden_layer.size());
 }
 
 void network_classifier::propagate(const classifier_features& features, vector<double>& hidden_layer, vector<double>& output_layer) const {
   output_layer.assign(output_layer.size(), features.size() * missing_weight);
 
   // Direct connections
-  for (auto&& feature : features)
-    if (feature < indices.size())
-      for (unsigned i = 0; i < indices[feature].size(); i++)
-        output_layer[indices[feature][i]] += weights[feature][i] - missing_weight;
+  if (quantized_weights.empty()) {
+    for (auto&& feature : features)
+      if (feature < indices.size())
+        for (unsigned i = 0; i < indices[feature].size(); i++)
+          output_layer[indices[feature][i]] += weights[feature][i] - missing_weight;
+  } else {
+    for (auto&& feature : features)
+      if (feature < indices.size()) {
+        float scale = quantized_scales[feature];
+        for (unsigned i = 0; i < indices[feature].size(); i++)
+          output_layer[indices[feature][i]] += scale * quantized_weights[feature][i];
+      }
+  }
 
   // Hidden layer
   if (!hidden_layer.empty()) {
@@ -217,7 +373,7 @@ void network_classifier::propagate(const classifier_features& features, vector<d
     output_layer[i] *= sum;
 }
 
-classifier_outcome network_classifier::best_outcome() {
+classifier_outcome network_classifier::best_outcome(const vector<double>& output_layer) {
   classifier_outcome best = 0;
   for (unsigned i = 1; i < output_layer.size(); i++)
     if (output_layer[i] > output_layer[best])
@@ -226,13 +382,18 @@ classifier_outcome network_classifier::best_outcome() {
   return best;
 }
 
-void network_classifier::backpropagate(const classifier_instance& instance, double learning_rate, double gaussian_sigma) {
+void network_classifier::backpropagate(const classifier_features& features, classifier_outcome outcome, double learning_rate, double gaussian_sigma, workspace& w) {
+  auto& hidden_layer = w.hidden_layer;
+  auto& hidden_error = w.hidden_error;
+  auto& output_layer = w.output_layer;
+  auto& output_error = w.output_error;
+
   // Compute error vector
   for (unsigned i = 0; i < output_error.size(); i++)
-    output_error[i] = (i == instance.outcome) - output_layer[i];
+    output_error[i] = (i == outcome) - output_layer[i];
 
   // Update direct connections
-  for (auto&& feature : instance.features)
+  for (auto&& feature : features)
     for (unsigned i = 0; i < indices[feature].size(); i++)
       weights[feature][i] += learning_rate * output_error[indices[feature][i]] - weights[feature][i] * gaussian_sigma;
 
@@ -252,7 +413,7 @@ void network_classifier::backpropagate(const classifier_instance& instance, doub
         hidden_weights[1][h][i] += learning_rate * hidden_layer[h] * output_error[i] - hidden_weights[1][h][i] * gaussian_sigma;
 
     // Update hidden_weights[0]
-    for (auto&& feature : instance.features)
+    for (auto&& feature : features)
       for (unsigned i = 0; i < hidden_layer.size(); i++)
         hidden_weights[0][feature][i] += learning_rate * hidden_error[i] - hidden_weights[0][feature][i] * gaussian_sigma;
   }
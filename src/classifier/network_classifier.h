@@ -10,8 +10,9 @@
 #pragma once
 
 #include "common.h"
-#include "classifier_instance.h"
+#include "classifier_instances.h"
 #include "network_parameters.h"
+#include "ner/ner.h"
 #include "utils/binary_decoder.h"
 #include "utils/binary_encoder.h"
 
@@ -23,31 +24,65 @@ class network_classifier {
   bool load(istream& is);
   bool save(ostream& os);
 
-  bool train(unsigned features, unsigned outcomes, const vector<classifier_instance>& train,
-             const vector<classifier_instance>& heldout, const network_parameters& parameters, bool verbose);
+  bool train(unsigned features, unsigned outcomes, const classifier_instances_source& train,
+             const classifier_instances& heldout, const network_parameters& parameters, bool verbose);
 
   void classify(const classifier_features& features, vector<double>& outcomes, vector<double>& buffer) const;
 
+  // Fraction of correctly classified instances.
+  double accuracy(const classifier_instances& instances) const;
+
+  // Model compaction -- remove the direct connections whose weights differ
+  // from the missing weight by less than the threshold, returning their count,
+  // mark the features which are still used, and renumber the features,
+  // removing the ones renumbered to ~0U.
+  size_t prune(double threshold);
+  void used_features(vector<bool>& used) const;
+  void renumber_features(const vector<uint32_t>& renumbering);
+  size_t weights_count() const;
+
+  // Append the memory allocated by the network, including the fraction of
+  // the direct connections which are stored.
+  void memory_footprint(const string& name, vector<memory_component>& components) const;
+
+  // Replace the direct connection weights by their differences from the
+  // missing weight, quantized to int8 with a scale for every feature.
+  void quantize();
+  bool quantized() const;
+
  private:
+  enum { QUANTIZED_INT8 = 1 };
+
   // Direct connections
   vector<vector<float>> weights;
   vector<vector<uint32_t>> indices;
   double missing_weight;
 
+  // Quantized direct connections, used instead of weights when not empty
+  vector<vector<int8_t>> quantized_weights;
+  vector<float> quantized_scales;
+
   // Hidden layer, experimental use only
   vector<vector<float>> hidden_weights[2];
-  vector<double> hidden_layer, hidden_error;
+  vector<double> hidden_layer;
 
   // Output layer
-  vector<double> output_layer, output_error;
+  vector<double> output_layer;
+
+  // Buffers used during training, one per training thread
+  struct workspace {
+    classifier_features features;
+    vector<double> hidden_layer, hidden_error, output_layer, output_error;
+    workspace(unsigned hidden, unsigned outcomes) : hidden_layer(hidden), hidden_error(hidden), output_layer(outcomes), output_error(outcomes) {}
+  };
 
-  inline void propagate(const classifier_features& features);
   inline void propagate(const classifier_features& features, vector<double>& hidden_layer, vector<double>& output_layer) const;
-  inline void backpropagate(const classifier_instance& instance, double learning_rate, double gaussian_sigma);
-  inline classifier_outcome best_outcome();
+  inline void backpropagate(const classifier_features& features, classifier_outcome outcome, double learning_rate, double gaussian_sigma, workspace& w);
+  static inline classifier_outcome best_outcome(const vector<double>& output_layer);
 
   template<class T> void load_matrix(binary_decoder& data, vector<vector<T>>& m);
   template<class T> void save_matrix(binary_encoder& enc, const vector<vector<T>>& m);
+  template<class T> static void renumber_rows(vector<T>& rows, const vector<uint32_t>& renumbering, size_t features);
 };
 
 } // namespace nametag
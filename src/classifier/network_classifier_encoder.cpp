@@ -7,6 +7,9 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <cmath>
+
 #include "network_classifier.h"
 #include "utils/compressor.h"
 
@@ -19,7 +22,10 @@ bool network_classifier::save(ostream& os) {
   // Direct connections
   save_matrix(enc, indices);
   enc.add_double(missing_weight);
-  save_matrix(enc, weights);
+  if (quantized_weights.empty())
+    save_matrix(enc, weights);
+  else
+    enc.add_4B(0);
 
   // Hidden layer
   enc.add_2B(hidden_layer.size());
@@ -31,9 +37,99 @@ bool network_classifier::save(ostream& os) {
   // Output layer
   enc.add_2B(output_layer.size());
 
+  // Quantized direct connections are stored last, so that models without
+  // them keep the original format
+  if (!quantized_weights.empty()) {
+    enc.add_1B(QUANTIZED_INT8);
+    enc.add_4B(quantized_scales.size());
+    enc.add_data(quantized_scales.data(), quantized_scales.size());
+    save_matrix(enc, quantized_weights);
+  }
+
   return compressor::save(os, enc);
 }
 
+size_t network_classifier::prune(double threshold) {
+  size_t pruned = 0;
+  for (unsigned f = 0; f < indices.size(); f++) {
+    unsigned kept = 0;
+    if (quantized_weights.empty()) {
+      for (unsigned i = 0; i < indices[f].size(); i++)
+        if (abs(weights[f][i] - missing_weight) >= threshold) {
+          indices[f][kept] = indices[f][i];
+          weights[f][kept++] = weights[f][i];
+        }
+      weights[f].resize(kept);
+    } else {
+      for (unsigned i = 0; i < indices[f].size(); i++)
+        if (abs(quantized_scales[f] * quantized_weights[f][i]) >= threshold) {
+          indices[f][kept] = indices[f][i];
+          quantized_weights[f][kept++] = quantized_weights[f][i];
+        }
+      quantized_weights[f].resize(kept);
+    }
+    pruned += indices[f].size() - kept;
+    indices[f].resize(kept);
+  }
+  return pruned;
+}
+
+void network_classifier::used_features(vector<bool>& used) const {
+  if (used.size() < indices.size()) used.resize(indices.size(), false);
+  for (unsigned f = 0; f < indices.size(); f++)
+    if (!indices[f].empty()) used[f] = true;
+
+  // The hidden layer has dense weights, so all its features are used
+  if (!hidden_layer.empty()) {
+    if (used.size() < hidden_weights[0].size()) used.resize(hidden_weights[0].size(), false);
+    for (unsigned f = 0; f < hidden_weights[0].size(); f++)
+      used[f] = true;
+  }
+}
+
+void network_classifier::renumber_features(const vector<uint32_t>& renumbering) {
+  size_t features = indices.size();
+  renumber_rows(indices, renumbering, features);
+  if (quantized_weights.empty()) {
+    renumber_rows(weights, renumbering, features);
+  } else {
+    renumber_rows(quantized_weights, renumbering, features);
+    renumber_rows(quantized_scales, renumbering, features);
+  }
+  if (!hidden_layer.empty()) renumber_rows(hidden_weights[0], renumbering, hidden_weights[0].size());
+}
+
+template <class T>
+void network_classifier::renumber_rows(vector<T>& rows, const vector<uint32_t>& renumbering, size_t features) {
+  size_t size = 0;
+  for (unsigned f = 0; f < features; f++)
+    if (renumbering[f] != ~0U) size = max(size, size_t(renumbering[f]) + 1);
+
+  vector<T> renumbered(size);
+  for (unsigned f = 0; f < features; f++)
+    if (renumbering[f] != ~0U)
+      swap(renumbered[renumbering[f]], rows[f]);
+  rows.swap(renumbered);
+}
+
+void network_classifier::quantize() {
+  if (!quantized_weights.empty()) return;
+
+  quantized_weights.resize(indices.size());
+  quantized_scales.resize(indices.size());
+  for (unsigned f = 0; f < indices.size(); f++) {
+    float max_difference = 0.f;
+    for (auto&& weight : weights[f])
+      max_difference = max(max_difference, float(abs(weight - missing_weight)));
+    quantized_scales[f] = max_difference / 127.f;
+
+    quantized_weights[f].resize(weights[f].size());
+    for (unsigned i = 0; i < weights[f].size(); i++)
+      quantized_weights[f][i] = max_difference ? int8_t(lround((weights[f][i] - missing_weight) / quantized_scales[f])) : 0;
+  }
+  weights.clear();
+}
+
 template <class T>
 void network_classifier::save_matrix(binary_encoder& enc, const vector<vector<T>>& m) {
   enc.add_4B(m.size());
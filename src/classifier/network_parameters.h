@@ -21,6 +21,8 @@ struct network_parameters {
   double final_learning_rate;
   double gaussian_sigma;
   int hidden_layer; // Experimental use only.
+  int threads = 1; // With more threads, lock-free Hogwild-style SGD is used.
+  int early_stopping = 0; // Stop after this many iterations without heldout improvement.
 };
 
 } // namespace nametag
@@ -0,0 +1,163 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <fstream>
+
+#include "ner/bilou_ner_compactor.h"
+#include "ner/ner.h"
+#include "utils/iostreams.h"
+#include "utils/options.h"
+#include "utils/parse_double.h"
+#include "utils/path_from_utf8.h"
+#include "utils/split.h"
+#include "version/version.h"
+
+using namespace ufal::nametag;
+
+struct heldout_sentence {
+  vector<string> forms;
+  vector<named_entity> entities;
+};
+
+struct model_evaluation {
+  size_t size;
+  double load_time, words_per_second, f1;
+};
+
+static void load_heldout(istream& is, vector<heldout_sentence>& heldout);
+static void evaluate(const char* model_file, const vector<heldout_sentence>& heldout, model_evaluation& evaluation);
+
+int main(int argc, char* argv[]) {
+  iostreams_init();
+
+  options::map options;
+  if (!options::parse({{"threshold", options::value::any},
+                       {"heldout", options::value::any},
+                       {"quantize", options::value::none},
+                       {"version", options::value::none},
+                       {"help", options::value::none}}, argc, argv, options) ||
+      options.count("help") ||
+      (argc != 3 && !options.count("version")))
+    runtime_failure("Usage: " << argv[0] << " [options] input_model output_model\n"
+                    "Options: --threshold=remove weights differing from missing weight by less than this (default 0)\n"
+                    "         --heldout=heldout data to compare the models on\n"
+                    "         --quantize (store network weights as 8-bit integers)\n"
+                    "         --version\n"
+                    "         --help");
+  if (options.count("version"))
+    return cout << version::version_and_copyright() << endl, 0;
+
+  double threshold = options.count("threshold") ? parse_double(options["threshold"], "threshold") : 0.;
+  if (threshold < 0) runtime_failure("The threshold must not be negative!");
+
+  vector<heldout_sentence> heldout;
+  if (options.count("heldout")) {
+    ifstream heldout_file(path_from_utf8(options["heldout"]).c_str());
+    if (!heldout_file.is_open()) runtime_failure("Cannot open heldout file '" << options["heldout"] << "'!");
+    load_heldout(heldout_file, heldout);
+  }
+
+  // Compact the model
+  {
+    ifstream input(path_from_utf8(argv[1]).c_str(), ifstream::in | ifstream::binary);
+    if (!input.is_open()) runtime_failure("Cannot open input model '" << argv[1] << "'!");
+    ofstream output(path_from_utf8(argv[2]).c_str(), ofstream::out | ofstream::binary);
+    if (!output.is_open()) runtime_failure("Cannot open output model '" << argv[2] << "'!");
+
+    bilou_ner_compactor::statistics stats;
+    bilou_ner_compactor::compact(input, output, threshold, options.count("quantize"), stats);
+    if (!output.flush()) runtime_failure("Cannot write output model '" << argv[2] << "'!");
+
+    cerr << "Removed " << stats.pruned_weights << " of " << stats.weights << " weights, "
+         << "the number of features decreased from " << stats.features << " to " << stats.compacted_features << "." << endl;
+  }
+
+  // Compare the models
+  model_evaluation original, compacted;
+  evaluate(argv[1], heldout, original);
+  evaluate(argv[2], heldout, compacted);
+
+  cerr << fixed << setprecision(3)
+       << "Model size: " << original.size << " -> " << compacted.size << " bytes ("
+       << 100. * compacted.size / original.size << "%)" << endl
+       << "Load time: " << original.load_time << " -> " << compacted.load_time << " seconds" << endl;
+  if (!heldout.empty())
+    cerr << setprecision(0) << "Throughput: " << original.words_per_second << " -> " << compacted.words_per_second << " words/s" << endl
+         << setprecision(2) << "Heldout F1: " << original.f1 << "% -> " << compacted.f1 << "% ("
+         << showpos << compacted.f1 - original.f1 << noshowpos << "%)" << endl;
+
+  return 0;
+}
+
+void load_heldout(istream& is, vector<heldout_sentence>& heldout) {
+  heldout.clear();
+
+  string line, label;
+  vector<string> tokens;
+  bool in_sentence = false;
+  while (getline(is, line)) {
+    if (line.empty()) {
+      in_sentence = false;
+      continue;
+    }
+
+    split(line, '\t', tokens);
+    if (tokens.size() != 2) runtime_failure("The NER data line '" << line << "' does not contain two columns!");
+    if (!in_sentence) heldout.emplace_back(), label.clear(), in_sentence = true;
+
+    // Decode the BIO encoded entities
+    auto& sentence = heldout.back();
+    if (tokens[1] == "_" || tokens[1] == "O")
+      label.clear();
+    else if (tokens[1].size() >= 3 && (tokens[1].compare(0, 2, "I-") == 0 || tokens[1].compare(0, 2, "B-") == 0)) {
+      if (tokens[1][0] == 'I' && tokens[1].compare(2, string::npos, label) == 0 && !sentence.entities.empty())
+        sentence.entities.back().length++;
+      else
+        sentence.entities.emplace_back(sentence.forms.size(), 1, label.assign(tokens[1], 2, string::npos));
+    } else
+      runtime_failure("Cannot parse entity type " << tokens[1] << "!");
+    sentence.forms.push_back(tokens[0]);
+  }
+}
+
+void evaluate(const char* model_file, const vector<heldout_sentence>& heldout, model_evaluation& evaluation) {
+  ifstream model(path_from_utf8(model_file).c_str(), ifstream::in | ifstream::binary);
+  if (!model.is_open()) runtime_failure("Cannot open model '" << model_file << "'!");
+  evaluation.size = model.seekg(0, ifstream::end).tellg();
+  model.seekg(0, ifstream::beg);
+
+  auto start = chrono::steady_clock::now();
+  unique_ptr<ner> recognizer(ner::load(model));
+  if (!recognizer) runtime_failure("Cannot load ner from file '" << model_file << "'!");
+  evaluation.load_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  size_t words = 0, gold = 0, predicted = 0, correct = 0;
+  vector<string_piece> forms;
+  vector<named_entity> entities;
+  start = chrono::steady_clock::now();
+  for (auto&& sentence : heldout) {
+    forms.assign(sentence.forms.begin(), sentence.forms.end());
+    recognizer->recognize(forms, entities);
+
+    words += forms.size();
+    gold += sentence.entities.size();
+    predicted += entities.size();
+    for (auto&& entity : entities)
+      for (auto&& gold_entity : sentence.entities)
+        if (entity.start == gold_entity.start && entity.length == gold_entity.length && entity.type == gold_entity.type) {
+          correct++;
+          break;
+        }
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  evaluation.words_per_second = seconds > 0 ? words / seconds : 0;
+  evaluation.f1 = gold + predicted ? 100. * 2 * correct / (gold + predicted) : 100.;
+}
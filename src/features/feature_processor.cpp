@@ -10,6 +10,7 @@
 #include <algorithm>
 
 #include "feature_processor.h"
+#include "ner/memory_footprint.h"
 
 namespace ufal {
 namespace nametag {
@@ -58,9 +59,41 @@ void feature_processor::save(binary_encoder& enc) {
 
 void feature_processor::process_sentence(ner_sentence& /*sentence*/, ner_feature* /*total_features*/, string& /*buffer*/) const {}
 
-void feature_processor::process_entities(ner_sentence& /*sentence*/, vector<named_entity>& /*entities*/, vector<named_entity>& /*buffer*/) const {}
+bool feature_processor::stage_dependent() const {
+  return false;
+}
+
+void feature_processor::resolve_entities(entity_map& /*entities*/) {}
+
+void feature_processor::process_entities(ner_sentence& /*sentence*/, vector<named_entity_id>& /*entities*/, vector<named_entity_id>& /*buffer*/) const {}
 
 void feature_processor::gazetteers(vector<string>& /*gazetteers*/, vector<int>* /*gazetteer_types*/) const {}
 
+void feature_processor::vocabulary(vector<string>& /*forms*/) const {}
+
+void feature_processor::memory_footprint(const string& name, vector<memory_component>& components) const {
+  components.emplace_back(name + " map", ufal::nametag::memory_footprint(map), map.size());
+}
+
+void feature_processor::allocated_features(vector<ner_feature>& features, bool& removable) const {
+  for (auto&& element : map)
+    features.push_back(element.second);
+  removable = true;
+}
+
+void feature_processor::renumber_features(const vector<ner_feature>& renumbering) {
+  for (auto it = map.begin(); it != map.end(); )
+    if (renumbering[it->second] == ner_feature_unknown) {
+      it = map.erase(it);
+    } else {
+      it->second = renumbering[it->second];
+      it++;
+    }
+}
+
+int feature_processor::get_window() const {
+  return window;
+}
+
 } // namespace nametag
 } // namespace ufal
@@ -30,9 +30,25 @@ class feature_processor {
   virtual void save(binary_encoder& enc);
 
   virtual void process_sentence(ner_sentence& sentence, ner_feature* total_features, string& buffer) const;
-  virtual void process_entities(ner_sentence& sentence, vector<named_entity>& entities, vector<named_entity>& buffer) const;
+  virtual bool stage_dependent() const;
+  // Resolve the entity types used by process_entities, adding them to the
+  // entity map when needed. Called after loading the model.
+  virtual void resolve_entities(entity_map& entities);
+  virtual void process_entities(ner_sentence& sentence, vector<named_entity_id>& entities, vector<named_entity_id>& buffer) const;
 
   virtual void gazetteers(vector<string>& gazetteers, vector<int>* gazetteer_types) const;
+  virtual void vocabulary(vector<string>& forms) const;
+
+  // Append the memory allocated by the processor, naming the components
+  // using the given processor name.
+  virtual void memory_footprint(const string& name, vector<memory_component>& components) const;
+
+  // Model compaction -- report the central features of all allocated feature
+  // windows and whether they can be removed, then renumber them, removing
+  // the ones renumbered to ner_feature_unknown.
+  virtual void allocated_features(vector<ner_feature>& features, bool& removable) const;
+  virtual void renumber_features(const vector<ner_feature>& renumbering);
+  int get_window() const;
 
  protected:
   int window;
@@ -12,6 +12,7 @@
 #include <unordered_map>
 
 #include "feature_processor.h"
+#include "ner/memory_footprint.h"
 #include "unilib/unicode.h"
 #include "unilib/utf8.h"
 #include "utils/parse_int.h"
@@ -131,6 +132,50 @@ class brown_clusters : public feature_processor {
     }
   }
 
+  virtual void vocabulary(vector<string>& forms) const override {
+    for (auto&& element : map)
+      if (!element.first.empty())
+        forms.push_back(element.first);
+  }
+
+  virtual void memory_footprint(const string& name, vector<memory_component>& components) const override {
+    feature_processor::memory_footprint(name, components);
+    components.emplace_back(name + " clusters", ufal::nametag::memory_footprint(clusters), clusters.size());
+  }
+
+  virtual void allocated_features(vector<ner_feature>& features, bool& removable) const override {
+    for (auto&& cluster : clusters)
+      features.insert(features.end(), cluster.begin(), cluster.end());
+    removable = true;
+  }
+
+  virtual void renumber_features(const vector<ner_feature>& renumbering) override {
+    // Renumber the cluster features, dropping the clusters left without any
+    vector<unsigned> cluster_renumbering(clusters.size(), ~0U);
+    unsigned clusters_kept = 0;
+    for (unsigned i = 0; i < clusters.size(); i++) {
+      unsigned features_kept = 0;
+      for (auto&& feature : clusters[i])
+        if (renumbering[feature] != ner_feature_unknown)
+          clusters[i][features_kept++] = renumbering[feature];
+      clusters[i].resize(features_kept);
+
+      if (features_kept) {
+        cluster_renumbering[i] = clusters_kept;
+        clusters[clusters_kept++].swap(clusters[i]);
+      }
+    }
+    clusters.resize(clusters_kept);
+
+    for (auto it = map.begin(); it != map.end(); )
+      if (it->second < cluster_renumbering.size() && cluster_renumbering[it->second] != ~0U) {
+        it->second = cluster_renumbering[it->second];
+        it++;
+      } else {
+        it = map.erase(it);
+      }
+  }
+
  private:
   vector<vector<ner_feature>> clusters;
 };
@@ -145,41 +190,56 @@ class czech_add_containers : public feature_processor {
     return feature_processor::parse(window, args, entities, total_features, pipeline);
   }
 
-  virtual void process_entities(ner_sentence& /*sentence*/, vector<named_entity>& entities, vector<named_entity>& buffer) const override {
+  virtual void resolve_entities(entity_map& entities) override {
+    pf = entities.parse("pf");
+    ps = entities.parse("ps");
+    td = entities.parse("td");
+    tm = entities.parse("tm");
+    ty = entities.parse("ty");
+    P = entities.parse("P", true);
+    T = entities.parse("T", true);
+  }
+
+  virtual void process_entities(ner_sentence& /*sentence*/, vector<named_entity_id>& entities, vector<named_entity_id>& buffer) const override {
     buffer.clear();
 
     for (unsigned i = 0; i < entities.size(); i++) {
       // P if ps+ pf+
-      if (entities[i].type.compare("pf") == 0 && (!i || entities[i-1].start + entities[i-1].length < entities[i].start || entities[i-1].type.compare("pf") != 0)) {
+      if (entities[i].type == pf && (!i || entities[i-1].start + entities[i-1].length < entities[i].start || entities[i-1].type != pf)) {
         unsigned j = i + 1;
-        while (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type.compare("pf") == 0) j++;
-        if (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type.compare("ps") == 0) {
+        while (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type == pf) j++;
+        if (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type == ps) {
           j++;
-          while (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type.compare("ps") == 0) j++;
-          buffer.emplace_back(entities[i].start, entities[j - 1].start + entities[j - 1].length - entities[i].start, "P");
+          while (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type == ps) j++;
+          buffer.emplace_back(entities[i].start, entities[j - 1].start + entities[j - 1].length - entities[i].start, P);
         }
       }
 
       // T if td tm ty | td tm
-      if (entities[i].type.compare("td") == 0 && i+1 < entities.size() && entities[i+1].start == entities[i].start + entities[i].length && entities[i+1].type.compare("tm") == 0) {
+      if (entities[i].type == td && i+1 < entities.size() && entities[i+1].start == entities[i].start + entities[i].length && entities[i+1].type == tm) {
         unsigned j = i + 2;
-        if (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type.compare("ty") == 0) j++;
-        buffer.emplace_back(entities[i].start, entities[j - 1].start + entities[j - 1].length - entities[i].start, "T");
+        if (j < entities.size() && entities[j].start == entities[j-1].start + entities[j-1].length && entities[j].type == ty) j++;
+        buffer.emplace_back(entities[i].start, entities[j - 1].start + entities[j - 1].length - entities[i].start, T);
       }
       // T if !td tm ty
-      if (entities[i].type.compare("tm") == 0 && (!i || entities[i-1].start + entities[i-1].length < entities[i].start || entities[i-1].type.compare("td") != 0))
-        if (i+1 < entities.size() && entities[i+1].start == entities[i].start + entities[i].length && entities[i+1].type.compare("ty") == 0)
-          buffer.emplace_back(entities[i].start, entities[i + 1].start + entities[i + 1].length - entities[i].start, "T");
+      if (entities[i].type == tm && (!i || entities[i-1].start + entities[i-1].length < entities[i].start || entities[i-1].type != td))
+        if (i+1 < entities.size() && entities[i+1].start == entities[i].start + entities[i].length && entities[i+1].type == ty)
+          buffer.emplace_back(entities[i].start, entities[i + 1].start + entities[i + 1].length - entities[i].start, T);
 
       buffer.push_back(entities[i]);
     }
 
-    if (buffer.size() > entities.size()) entities = buffer;
+    if (buffer.size() > entities.size()) entities.swap(buffer);
   }
 
   // CzechAddContainers used to be entity_processor which had empty load and save methods.
   virtual void load(binary_decoder& /*data*/, const nlp_pipeline& /*pipeline*/) override {}
   virtual void save(binary_encoder& /*enc*/) override {}
+
+ private:
+  // Types of the contained entities and of the containers
+  entity_type pf = entity_type_unknown, ps = entity_type_unknown, td = entity_type_unknown, tm = entity_type_unknown, ty = entity_type_unknown;
+  entity_type P = entity_type_unknown, T = entity_type_unknown;
 };
 
 
@@ -207,6 +267,12 @@ class form : public feature_processor {
 
     apply_outer_words_in_window(lookup_empty());
   }
+
+  virtual void vocabulary(vector<string>& forms) const override {
+    for (auto&& element : map)
+      if (!element.first.empty())
+        forms.push_back(element.first);
+  }
 };
 
 
@@ -356,6 +422,32 @@ class gazetteers : public feature_processor {
     }
   }
 
+  virtual void memory_footprint(const string& name, vector<memory_component>& components) const override {
+    feature_processor::memory_footprint(name, components);
+
+    size_t bytes = gazetteers_info.capacity() * sizeof(gazetteer_info);
+    for (auto&& info : gazetteers_info)
+      bytes += ufal::nametag::memory_footprint(info.features);
+    components.emplace_back(name + " gazetteers", bytes, gazetteers_info.size());
+  }
+
+  virtual void allocated_features(vector<ner_feature>& features, bool& removable) const override {
+    for (auto&& gazetteer : gazetteers_info)
+      features.insert(features.end(), gazetteer.features.begin(), gazetteer.features.end());
+    removable = true;
+  }
+
+  // Gazetteers without features are kept, they can still be prefixes of longer ones
+  virtual void renumber_features(const vector<ner_feature>& renumbering) override {
+    for (auto&& gazetteer : gazetteers_info) {
+      unsigned features_kept = 0;
+      for (auto&& feature : gazetteer.features)
+        if (renumbering[feature] != ner_feature_unknown)
+          gazetteer.features[features_kept++] = renumbering[feature];
+      gazetteer.features.resize(features_kept);
+    }
+  }
+
  private:
   struct gazetteer_info {
     vector<ner_feature> features;
@@ -401,6 +493,7 @@ class gazetteers_enhanced : public feature_processor {
       entity_list.push_back(entities.name(i));
 
     if (!load_gazetteer_lists(pipeline, embed == EMBED_IN_MODEL)) return false;
+    embedded_lists = embed == EMBED_IN_MODEL ? gazetteer_lists.size() : 0;
 
     return true;
   }
@@ -427,6 +520,7 @@ class gazetteers_enhanced : public feature_processor {
       gazetteer_list.entity = data.next_4B();
       gazetteer_list.mode = data.next_4B();
     }
+    embedded_lists = gazetteer_lists.size();
 
     entity_list.resize(data.next_4B());
     for (auto&& entity : entity_list)
@@ -447,18 +541,15 @@ class gazetteers_enhanced : public feature_processor {
       enc.add_4B(gazetteer_meta.entity);
     }
 
-    if (embed == EMBED_IN_MODEL) {
-      enc.add_4B(gazetteer_lists.size());
-      for (auto&& gazetteer_list : gazetteer_lists) {
-        enc.add_4B(gazetteer_list.gazetteers.size());
-        for (auto&& gazetteer : gazetteer_list.gazetteers)
-          enc.add_str(gazetteer);
-        enc.add_4B(gazetteer_list.feature);
-        enc.add_4B(gazetteer_list.entity);
-        enc.add_4B(gazetteer_list.mode);
-      }
-    } else {
-      enc.add_4B(0);
+    enc.add_4B(embedded_lists);
+    for (unsigned i = 0; i < embedded_lists; i++) {
+      auto& gazetteer_list = gazetteer_lists[i];
+      enc.add_4B(gazetteer_list.gazetteers.size());
+      for (auto&& gazetteer : gazetteer_list.gazetteers)
+        enc.add_str(gazetteer);
+      enc.add_4B(gazetteer_list.feature);
+      enc.add_4B(gazetteer_list.entity);
+      enc.add_4B(gazetteer_list.mode);
     }
 
     enc.add_4B(entity_list.size());
@@ -527,7 +618,12 @@ class gazetteers_enhanced : public feature_processor {
         apply_in_window(i, feature);
   }
 
-  virtual void process_entities(ner_sentence& sentence, vector<named_entity>& entities, vector<named_entity>& buffer) const override {
+  // The hard_pre probabilities are filled anew in every stage
+  virtual bool stage_dependent() const override {
+    return true;
+  }
+
+  virtual void process_entities(ner_sentence& sentence, vector<named_entity_id>& entities, vector<named_entity_id>& buffer) const override {
     vector<unsigned> nodes, new_nodes;
 
     vector<vector<string>> recased_match_sources(sentence.size);
@@ -568,7 +664,7 @@ class gazetteers_enhanced : public feature_processor {
         }
 
         if (hard_post_length) {
-          buffer.emplace_back(i, hard_post_length, entity_list[gazetteers_trie[hard_post_node].entity]);
+          buffer.emplace_back(i, hard_post_length, gazetteers_trie[hard_post_node].entity);
           entity_until = i + hard_post_length;
         }
       }
@@ -578,6 +674,49 @@ class gazetteers_enhanced : public feature_processor {
       entities.swap(buffer);
   }
 
+  // The gazetteer features are never removed, because the gazetteer lists
+  // can be loaded again from the files when the model is loaded.
+  virtual void memory_footprint(const string& name, vector<memory_component>& components) const override {
+    feature_processor::memory_footprint(name, components);
+
+    size_t bytes = gazetteer_metas.capacity() * sizeof(gazetteer_meta_info) + ufal::nametag::memory_footprint(entity_list);
+    for (auto&& meta : gazetteer_metas)
+      bytes += ufal::nametag::memory_footprint(meta.basename);
+    components.emplace_back(name + " metadata", bytes, gazetteer_metas.size());
+
+    size_t gazetteers_count = 0;
+    bytes = gazetteer_lists.capacity() * sizeof(gazetteer_list_info);
+    for (auto&& list : gazetteer_lists) {
+      bytes += ufal::nametag::memory_footprint(list.gazetteers);
+      gazetteers_count += list.gazetteers.size();
+    }
+    components.emplace_back(name + " lists", bytes, gazetteers_count, to_string(gazetteer_lists.size()) + " lists");
+
+    size_t children = 0;
+    bytes = gazetteers_trie.capacity() * sizeof(gazetteer_trie_node);
+    for (auto&& node : gazetteers_trie) {
+      bytes += ufal::nametag::memory_footprint(node.features) + ufal::nametag::memory_footprint(node.children);
+      children += node.children.size();
+    }
+    components.emplace_back(name + " trie", bytes, gazetteers_trie.size(), to_string(children) + " edges");
+  }
+
+  virtual void allocated_features(vector<ner_feature>& features, bool& removable) const override {
+    for (auto&& gazetteer_meta : gazetteer_metas)
+      features.push_back(gazetteer_meta.feature);
+    removable = false;
+  }
+
+  virtual void renumber_features(const vector<ner_feature>& renumbering) override {
+    for (auto&& gazetteer_meta : gazetteer_metas)
+      gazetteer_meta.feature = renumbering[gazetteer_meta.feature];
+    for (auto&& gazetteer_list : gazetteer_lists)
+      gazetteer_list.feature = renumbering[gazetteer_list.feature];
+    for (auto&& node : gazetteers_trie)
+      for (auto&& feature : node.features)
+        feature = renumbering[feature];
+  }
+
   virtual void gazetteers(vector<string>& gazetteers, vector<int>* gazetteer_types) const override {
     for (auto&& gazetteer_list : gazetteer_lists)
       for (auto&& gazetteer : gazetteer_list.gazetteers) {
@@ -592,6 +731,7 @@ class gazetteers_enhanced : public feature_processor {
 
   enum { EMBED_IN_MODEL = 0, OUT_OF_MODEL = 1 };
   int embed;
+  unsigned embedded_lists; // The gazetteer lists stored in the model precede the ones loaded from files
 
   enum { SOFT, HARD_PRE, HARD_POST, MODES_TOTAL };
   const static vector<string> basename_suffixes;
@@ -826,6 +966,10 @@ class previous_stage : public feature_processor {
       }
   }
 
+  virtual bool stage_dependent() const override {
+    return true;
+  }
+
  private:
   static void append_encoded(string& str, int value) {
     if (value < 0) {
@@ -1014,6 +1158,11 @@ class url_email_detector : public feature_processor {
     }
   }
 
+  // The probabilities are filled anew in every stage
+  virtual bool stage_dependent() const override {
+    return true;
+  }
+
  private:
   entity_type url, email;
 };
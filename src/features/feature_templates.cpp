@@ -7,7 +7,10 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+
 #include "feature_templates.h"
+#include "ner/recognition_profile.h"
 #include "utils/compressor.h"
 #include "utils/binary_decoder.h"
 
@@ -51,12 +54,51 @@ void feature_templates::process_sentence(ner_sentence& sentence, string& buffer,
     sentence.features[i].emplace_back(0);
   }
 
-  // Add features from feature processors
+  // Add features from feature processors, remembering how many features
+  // precede the first stage-dependent processor
+  bool stage_independent = true;
+  for (unsigned p = 0; p < processors.size(); p++) {
+    if (stage_independent && processors[p].processor->stage_dependent()) {
+      for (unsigned i = 0; i < sentence.size; i++)
+        sentence.stage_independent_features[i] = sentence.features[i].size();
+      stage_independent = false;
+    }
+    NAMETAG_PROFILE_START(start);
+    processors[p].processor->process_sentence(sentence, adding_features ? &total_features : nullptr, buffer);
+    NAMETAG_PROFILE_ADD(recognition_profile::FEATURE_PROCESSORS + p, start, 1);
+  }
+  if (stage_independent)
+    for (unsigned i = 0; i < sentence.size; i++)
+      sentence.stage_independent_features[i] = sentence.features[i].size();
+}
+
+void feature_templates::process_sentence_stage_dependent(ner_sentence& sentence, string& buffer, bool adding_features) const {
+  // Keep the stage-independent features
+  for (unsigned i = 0; i < sentence.size; i++)
+    sentence.features[i].resize(sentence.stage_independent_features[i]);
+
+  // Add features from the stage-dependent processor and the following ones
+  bool stage_independent = true;
+  for (unsigned p = 0; p < processors.size(); p++) {
+    if (stage_independent && processors[p].processor->stage_dependent()) stage_independent = false;
+    if (!stage_independent) {
+      NAMETAG_PROFILE_START(start);
+      processors[p].processor->process_sentence(sentence, adding_features ? &total_features : nullptr, buffer);
+      NAMETAG_PROFILE_ADD(recognition_profile::FEATURE_PROCESSORS + p, start, 1);
+    }
+  }
+}
+
+void feature_templates::process_sentence_processor(unsigned processor, ner_sentence& sentence, string& buffer) const {
+  processors[processor].processor->process_sentence(sentence, nullptr, buffer);
+}
+
+void feature_templates::resolve_entities(entity_map& entities) {
   for (auto&& processor : processors)
-    processor.processor->process_sentence(sentence, adding_features ? &total_features : nullptr, buffer);
+    processor.processor->resolve_entities(entities);
 }
 
-void feature_templates::process_entities(ner_sentence& sentence, vector<named_entity>& entities, vector<named_entity>& buffer) const {
+void feature_templates::process_entities(ner_sentence& sentence, vector<named_entity_id>& entities, vector<named_entity_id>& buffer) const {
   for (auto&& processor : processors)
     processor.processor->process_entities(sentence, entities, buffer);
 }
@@ -70,5 +112,25 @@ void feature_templates::gazetteers(vector<string>& gazetteers, vector<int>* gaze
     processor.processor->gazetteers(gazetteers, gazetteer_types);
 }
 
+void feature_templates::processor_names(vector<string>& names) const {
+  names.clear();
+  for (auto&& processor : processors)
+    names.push_back(processor.name);
+}
+
+void feature_templates::memory_footprint(vector<memory_component>& components) const {
+  for (auto&& processor : processors)
+    processor.processor->memory_footprint("features " + processor.name, components);
+}
+
+void feature_templates::vocabulary(vector<string>& forms) const {
+  forms.clear();
+  for (auto&& processor : processors)
+    processor.processor->vocabulary(forms);
+
+  sort(forms.begin(), forms.end());
+  forms.resize(unique(forms.begin(), forms.end()) - forms.begin());
+}
+
 } // namespace nametag
 } // namespace ufal
@@ -24,10 +24,25 @@ class feature_templates {
   bool save(ostream& os);
 
   void process_sentence(ner_sentence& sentence, string& buffer, bool add_features = false) const;
-  void process_entities(ner_sentence& sentence, vector<named_entity>& entities, vector<named_entity>& buffer) const;
+  // Recompute only the features from the first stage-dependent processor on,
+  // keeping the ones computed by the last process_sentence call.
+  void process_sentence_stage_dependent(ner_sentence& sentence, string& buffer, bool add_features = false) const;
+  // Append the features of the given processor only, as used by microbenchmarks.
+  void process_sentence_processor(unsigned processor, ner_sentence& sentence, string& buffer) const;
+  void resolve_entities(entity_map& entities);
+  void process_entities(ner_sentence& sentence, vector<named_entity_id>& entities, vector<named_entity_id>& buffer) const;
   ner_feature get_total_features() const;
 
   void gazetteers(vector<string>& gazetteers, vector<int>* gazetteer_types) const;
+  void processor_names(vector<string>& names) const;
+  // Sorted unique forms known to the feature processors
+  void vocabulary(vector<string>& forms) const;
+  void memory_footprint(vector<memory_component>& components) const;
+
+  // Remove the feature windows containing no feature present in used_features
+  // and renumber the remaining ones. The renumbering of the original features
+  // is returned, with ner_feature_unknown denoting a removed feature.
+  void compact(const vector<bool>& used_features, vector<ner_feature>& renumbering);
 
  private:
   mutable ner_feature total_features;
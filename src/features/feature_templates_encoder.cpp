@@ -7,6 +7,8 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+
 #include "feature_templates.h"
 #include "utils/compressor.h"
 #include "utils/parse_int.h"
@@ -65,5 +67,53 @@ bool feature_templates::save(ostream& os) {
   return compressor::save(os, enc);
 }
 
+void feature_templates::compact(const vector<bool>& used_features, vector<ner_feature>& renumbering) {
+  // Gather the starts of all feature windows
+  vector<pair<ner_feature, bool>> windows;
+  vector<ner_feature> features;
+  int max_window = 0;
+  for (auto&& processor : processors) {
+    bool removable = true;
+    features.clear();
+    processor.processor->allocated_features(features, removable);
+    if (!features.empty()) max_window = max(max_window, processor.processor->get_window());
+
+    for (auto&& feature : features)
+      windows.emplace_back(feature - processor.processor->get_window(), removable);
+  }
+  sort(windows.begin(), windows.end());
+
+  // Merge the windows with the same start; the features preceding the first
+  // window are kept as if they formed a window.
+  vector<pair<ner_feature, bool>> starts;
+  if (windows.empty() || windows.front().first) starts.emplace_back(0, false);
+  for (auto&& window : windows)
+    if (!starts.empty() && starts.back().first == window.first)
+      starts.back().second = starts.back().second && window.second;
+    else
+      starts.push_back(window);
+
+  // Every window spans until the start of the next one. The windows starting
+  // in the first 2*max_window+1 features are always kept, because the outer
+  // words use these features directly.
+  renumbering.assign(total_features, ner_feature_unknown);
+  ner_feature compacted_features = 0;
+  for (unsigned i = 0; i < starts.size(); i++) {
+    ner_feature start = starts[i].first, end = i + 1 < starts.size() ? starts[i + 1].first : total_features;
+
+    bool used = !starts[i].second || start <= ner_feature(2 * max_window);
+    for (ner_feature feature = start; !used && feature < end; feature++)
+      used = feature < used_features.size() && used_features[feature];
+
+    if (used)
+      for (ner_feature feature = start; feature < end; feature++)
+        renumbering[feature] = compacted_features++;
+  }
+
+  for (auto&& processor : processors)
+    processor.processor->renumber_features(renumbering);
+  total_features = compacted_features;
+}
+
 } // namespace nametag
 } // namespace ufal
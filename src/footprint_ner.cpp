@@ -0,0 +1,63 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+
+#include "ner/ner.h"
+#include "utils/iostreams.h"
+#include "utils/options.h"
+#include "utils/peak_rss.h"
+#include "version/version.h"
+
+using namespace ufal::nametag;
+
+int main(int argc, char* argv[]) {
+  iostreams_init();
+
+  options::map options;
+  if (!options::parse({{"sort", options::value::none},
+                       {"version", options::value::none},
+                       {"help", options::value::none}}, argc, argv, options) ||
+      options.count("help") ||
+      (argc != 2 && !options.count("version")))
+    runtime_failure("Usage: " << argv[0] << " [options] recognizer_model\n"
+                    "Options: --sort (sort the components by size)\n"
+                    "         --version\n"
+                    "         --help");
+  if (options.count("version"))
+    return cout << version::version_and_copyright() << endl, 0;
+
+  uint64_t initial_rss = peak_rss_kb();
+  unique_ptr<ner> recognizer(ner::load(argv[1]));
+  if (!recognizer) runtime_failure("Cannot load ner from file '" << argv[1] << "'!");
+  uint64_t loaded_rss = peak_rss_kb();
+
+  vector<memory_component> components;
+  recognizer->memory_footprint(components);
+  if (options.count("sort"))
+    stable_sort(components.begin(), components.end(), [](const memory_component& a, const memory_component& b) { return a.bytes > b.bytes; });
+
+  size_t total = 0, name_width = 9;
+  for (auto&& component : components) {
+    total += component.bytes;
+    name_width = max(name_width, component.name.size());
+  }
+
+  cout << left << setw(name_width) << "Component" << right << setw(14) << "Bytes" << setw(8) << "Share" << setw(12) << "Entries" << "  Details" << endl;
+  for (auto&& component : components) {
+    cout << left << setw(name_width) << component.name << right << setw(14) << component.bytes
+         << setw(7) << fixed << setprecision(1) << (total ? 100. * component.bytes / total : 0.) << '%'
+         << setw(12) << component.entries << (component.details.empty() ? "" : "  ") << component.details << endl;
+  }
+  cout << left << setw(name_width) << "Total" << right << setw(14) << total << endl;
+  if (loaded_rss)
+    cout << "Peak resident memory increased by " << loaded_rss - initial_rss << " kB while loading the model." << endl;
+
+  return 0;
+}
@@ -149,6 +149,12 @@ tokenizer* czech_morpho::new_tokenizer() const {
   return new czech_tokenizer(language, version, this);
 }
 
+void czech_morpho::memory_footprint(vector<pair<string, size_t>>& components) const {
+  dictionary.memory_footprint(components);
+  if (prefix_guesser) components.emplace_back("prefix guesser", prefix_guesser->memory_footprint());
+  if (statistical_guesser) components.emplace_back("statistical guesser", statistical_guesser->memory_footprint());
+}
+
 // What characters are considered punctuation except for the ones in unicode Punctuation category.
 static bool punctuation_additional[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1/*$*/,
   0,0,0,0,0,0,1/*+*/,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1/*<*/,1/*=*/,1/*>*/,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
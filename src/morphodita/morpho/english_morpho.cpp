@@ -95,6 +95,11 @@ tokenizer* english_morpho::new_tokenizer() const {
   return new english_tokenizer(version <= 2 ? 1 : 2);
 }
 
+void english_morpho::memory_footprint(vector<pair<string, size_t>>& components) const {
+  dictionary.memory_footprint(components);
+  components.emplace_back("guesser", morpho_guesser.memory_footprint());
+}
+
 void english_morpho::analyze_special(string_piece form, vector<tagged_lemma>& lemmas) const {
   using namespace unilib;
 
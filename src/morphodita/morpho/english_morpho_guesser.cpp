@@ -23,6 +23,13 @@ namespace ufal {
 namespace nametag {
 namespace morphodita {
 
+size_t english_morpho_guesser::memory_footprint() const {
+  size_t bytes = exceptions.memory_footprint() + negations.memory_footprint() + exceptions_tags.capacity() * sizeof(string);
+  for (auto&& tag : exceptions_tags)
+    bytes += tag.capacity();
+  return bytes;
+}
+
 void english_morpho_guesser::load(binary_decoder& data) {
   unsigned tags = data.next_2B();
   exceptions_tags.clear();
@@ -23,6 +23,7 @@ class english_morpho_guesser {
   void load(binary_decoder& data);
   void analyze(string_piece form, string_piece form_lc, vector<tagged_lemma>& lemmas) const;
   bool analyze_proper_names(string_piece form, string_piece form_lc, vector<tagged_lemma>& lemmas) const;
+  size_t memory_footprint() const;
 
  private:
   inline void add(const string& tag, const string& form, vector<tagged_lemma>& lemmas) const;
@@ -123,6 +123,11 @@ tokenizer* generic_morpho::new_tokenizer() const {
   return new generic_tokenizer(version);
 }
 
+void generic_morpho::memory_footprint(vector<pair<string, size_t>>& components) const {
+  dictionary.memory_footprint(components);
+  if (statistical_guesser) components.emplace_back("statistical guesser", statistical_guesser->memory_footprint());
+}
+
 void generic_morpho::analyze_special(string_piece form, vector<tagged_lemma>& lemmas) const {
   using namespace unilib;
 
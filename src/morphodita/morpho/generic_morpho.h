@@ -28,6 +28,7 @@ class generic_morpho : public morpho {
   virtual int lemma_id_len(string_piece lemma) const override;
   virtual int raw_form_len(string_piece form) const override;
   virtual tokenizer* new_tokenizer() const override;
+  virtual void memory_footprint(vector<pair<string, size_t>>& components) const override;
 
   bool load(istream& is);
  private:
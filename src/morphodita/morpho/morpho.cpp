@@ -87,6 +87,8 @@ const derivator* morpho::get_derivator() const {
   return derinet.get();
 }
 
+void morpho::memory_footprint(vector<pair<string, size_t>>& /*components*/) const {}
+
 } // namespace morphodita
 } // namespace nametag
 } // namespace ufal
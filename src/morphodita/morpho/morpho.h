@@ -99,6 +99,9 @@ class morpho {
   // The returned instance is owned by the morphology and should not be deleted.
   virtual const derivator* get_derivator() const;
 
+  // Append the names and allocated bytes of the morphology components.
+  virtual void memory_footprint(vector<pair<string, size_t>>& components) const;
+
  protected:
   unique_ptr<derivator> derinet;
 };
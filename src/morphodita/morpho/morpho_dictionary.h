@@ -28,6 +28,7 @@ class morpho_dictionary {
   void load(binary_decoder& data);
   void analyze(string_piece form, vector<tagged_lemma>& lemmas) const;
   bool generate(string_piece lemma, const tag_filter& filter, vector<tagged_lemma_forms>& lemmas_forms) const;
+  void memory_footprint(vector<pair<string, size_t>>& components) const;
  private:
   persistent_unordered_map lemmas, roots, suffixes;
 
@@ -195,6 +196,26 @@ void morpho_dictionary<LemmaAddinfo>::analyze(string_piece form, vector<tagged_l
     }
 }
 
+template <class LemmaAddinfo>
+void morpho_dictionary<LemmaAddinfo>::memory_footprint(vector<pair<string, size_t>>& components) const {
+  components.emplace_back("dictionary lemmas", lemmas.memory_footprint());
+  components.emplace_back("dictionary roots", roots.memory_footprint());
+  components.emplace_back("dictionary suffixes", suffixes.memory_footprint());
+
+  size_t bytes = tags.capacity() * sizeof(string);
+  for (auto&& tag : tags)
+    bytes += tag.capacity();
+  components.emplace_back("dictionary tags", bytes);
+
+  bytes = classes.capacity() * sizeof(classes[0]);
+  for (auto&& clas : classes) {
+    bytes += clas.capacity() * sizeof(clas[0]);
+    for (auto&& suffix : clas)
+      bytes += suffix.first.capacity() + suffix.second.capacity() * sizeof(uint16_t);
+  }
+  components.emplace_back("dictionary classes", bytes);
+}
+
 template <class LemmaAddinfo>
 bool morpho_dictionary<LemmaAddinfo>::generate(string_piece lemma, const tag_filter& filter, vector<tagged_lemma_forms>& lemmas_forms) const {
   LemmaAddinfo addinfo;
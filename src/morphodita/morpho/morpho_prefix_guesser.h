@@ -30,6 +30,9 @@ class morpho_prefix_guesser {
   void load(binary_decoder& data);
   void analyze(string_piece form, vector<tagged_lemma>& lemmas);
   bool generate(string_piece lemma, const tag_filter& filter, vector<tagged_lemma_forms>& lemmas_forms);
+  size_t memory_footprint() const {
+    return prefixes_initial.memory_footprint() + prefixes_middle.memory_footprint() + tag_filters.capacity() * sizeof(tag_filter);
+  }
 
  private:
   const MorphoDictionary& dictionary;
@@ -16,6 +16,13 @@ namespace ufal {
 namespace nametag {
 namespace morphodita {
 
+size_t morpho_statistical_guesser::memory_footprint() const {
+  size_t bytes = rules.memory_footprint() + tags.capacity() * sizeof(string);
+  for (auto&& tag : tags)
+    bytes += tag.capacity();
+  return bytes;
+}
+
 void morpho_statistical_guesser::load(binary_decoder& data) {
   // Load tags and default tag
   tags.resize(data.next_2B());
@@ -23,6 +23,7 @@ class morpho_statistical_guesser {
   void load(binary_decoder& data);
   typedef vector<string> used_rules;
   void analyze(string_piece form, vector<tagged_lemma>& lemmas, used_rules* used);
+  size_t memory_footprint() const;
 
  private:
   vector<string> tags;
@@ -44,6 +44,9 @@ class persistent_unordered_map {
   inline int max_length() const;
   inline const unsigned char* data_start(int len) const;
 
+  // Number of bytes allocated by the map
+  inline size_t memory_footprint() const;
+
   // Creation functions
   persistent_unordered_map() {}
   template <class Entry, class EntryEncode>
@@ -184,6 +187,13 @@ int persistent_unordered_map::max_length() const {
   return hashes.size();
 }
 
+size_t persistent_unordered_map::memory_footprint() const {
+  size_t bytes = hashes.capacity() * sizeof(fnv_hash);
+  for (auto&& hash : hashes)
+    bytes += hash.hash.capacity() * sizeof(uint32_t) + hash.data.capacity();
+  return bytes;
+}
+
 const unsigned char* persistent_unordered_map::data_start(int len) const {
   return unsigned(len) < hashes.size() ? hashes[len].data.data() : nullptr;
 }
@@ -8,7 +8,7 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "tagger.h"
-#include "utils/threadsafe_stack.h"
+#include "utils/cache_pool.h"
 #include "viterbi.h"
 
 namespace ufal {
@@ -25,6 +25,7 @@ class perceptron_tagger : public tagger {
   virtual const morpho* get_morpho() const override;
   virtual void tag(const vector<string_piece>& forms, vector<tagged_lemma>& tags, morpho::guesser_mode guesser = morpho::guesser_mode(-1)) const override;
   virtual void tag_analyzed(const vector<string_piece>& forms, const vector<vector<tagged_lemma>>& analyses, vector<int>& tags) const override;
+  virtual void memory_footprint(vector<pair<string, size_t>>& components) const override;
 
  private:
   int decoding_order, window_size;
@@ -43,7 +44,7 @@ class perceptron_tagger : public tagger {
     cache(const perceptron_tagger<FeatureSequences>& self) : decoder_cache(self.decoder) {}
   };
 
-  mutable threadsafe_stack<cache> caches;
+  mutable cache_pool<cache> caches;
 };
 
 
@@ -53,6 +54,21 @@ template<class FeatureSequences>
 perceptron_tagger<FeatureSequences>::perceptron_tagger(int decoding_order, int window_size)
   : decoding_order(decoding_order), window_size(window_size), decoder(features, decoding_order, window_size) {}
 
+template<class FeatureSequences>
+void perceptron_tagger<FeatureSequences>::memory_footprint(vector<pair<string, size_t>>& components) const {
+  tagger::memory_footprint(components);
+
+  size_t bytes = 0;
+  for (auto&& map : features.elementary.maps)
+    bytes += map.memory_footprint();
+  components.emplace_back("elementary feature maps", bytes);
+
+  bytes = features.sequences.capacity() * sizeof(features.sequences[0]);
+  for (auto&& score : features.scores)
+    bytes += score.memory_footprint();
+  components.emplace_back("feature sequence scores", bytes);
+}
+
 template<class FeatureSequences>
 bool perceptron_tagger<FeatureSequences>::load(istream& is) {
   if (dict.reset(morpho::load(is)), !dict) return false;
@@ -68,6 +68,11 @@ tokenizer* tagger::new_tokenizer() const {
   return morpho ? morpho->new_tokenizer() : nullptr;
 }
 
+void tagger::memory_footprint(vector<pair<string, size_t>>& components) const {
+  auto morpho = get_morpho();
+  if (morpho) morpho->memory_footprint(components);
+}
+
 } // namespace morphodita
 } // namespace nametag
 } // namespace ufal
@@ -37,6 +37,10 @@ class tagger {
   // Can return NULL if no such tokenizer exists.
   // Is equal to get_morpho()->new_tokenizer.
   tokenizer* new_tokenizer() const;
+
+  // Append the names and allocated bytes of the tagger components,
+  // including its morphology.
+  virtual void memory_footprint(vector<pair<string, size_t>>& components) const;
 };
 
 } // namespace morphodita
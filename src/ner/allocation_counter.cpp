@@ -0,0 +1,59 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "allocation_counter.h"
+
+namespace ufal {
+namespace nametag {
+
+recognition_allocations::recognition_allocations(recognition_observer* next) : next(next) {
+  for (int stage = 0; stage < STAGES_TOTAL; stage++)
+    for (int network = 0; network < NETWORKS_MAX; network++) {
+      allocations[stage][network].store(0, memory_order_relaxed);
+      bytes[stage][network].store(0, memory_order_relaxed);
+      stage_calls[stage][network].store(0, memory_order_relaxed);
+    }
+}
+
+void recognition_allocations::recognition_started() {
+  last_counts() = allocation_counter::current();
+
+  if (next) next->recognition_started();
+}
+
+void recognition_allocations::stage_finished(stage_t stage, unsigned network, double seconds) {
+  auto& last = last_counts();
+  auto current = allocation_counter::current();
+  unsigned index = network < NETWORKS_MAX ? network : NETWORKS_MAX - 1;
+  allocations[stage][index].fetch_add(current.allocations - last.allocations, memory_order_relaxed);
+  bytes[stage][index].fetch_add(current.bytes - last.bytes, memory_order_relaxed);
+  stage_calls[stage][index].fetch_add(1, memory_order_relaxed);
+
+  if (next) next->stage_finished(stage, network, seconds);
+
+  // Allocations of the forwarded observer are not attributed to any stage
+  last = allocation_counter::current();
+}
+
+allocation_counter::counts recognition_allocations::stage(stage_t stage, unsigned network) const {
+  allocation_counter::counts counts = {allocations[stage][network].load(memory_order_relaxed), bytes[stage][network].load(memory_order_relaxed)};
+  return counts;
+}
+
+uint64_t recognition_allocations::calls(stage_t stage, unsigned network) const {
+  return stage_calls[stage][network].load(memory_order_relaxed);
+}
+
+allocation_counter::counts& recognition_allocations::last_counts() {
+  static thread_local allocation_counter::counts last = {0, 0};
+  return last;
+}
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,65 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+
+#include "common.h"
+#include "recognition_observer.h"
+
+namespace ufal {
+namespace nametag {
+
+// Heap allocations performed by the current thread. The counts are
+// maintained by the replacement of the global operator new, which is defined
+// in allocation_hooks.cpp and is therefore present only in the binaries
+// linking it; otherwise the counts stay zero and installed() is false.
+class allocation_counter {
+ public:
+  struct counts {
+    uint64_t allocations, bytes;
+  };
+
+  static inline counts& current() {
+    static thread_local counts counts = {0, 0};
+    return counts;
+  }
+
+  static inline bool& installed() {
+    static bool installed = false;
+    return installed;
+  }
+};
+
+// Observer attributing the allocations of the current thread to the
+// recognition stages, summed over all threads. The stages can be forwarded
+// to another observer.
+class recognition_allocations : public recognition_observer {
+ public:
+  enum { NETWORKS_MAX = 16 };
+
+  recognition_allocations(recognition_observer* next = nullptr);
+
+  virtual void recognition_started() override;
+  virtual void stage_finished(stage_t stage, unsigned network, double seconds) override;
+
+  // Allocations of the given stage and the number of times it was performed.
+  allocation_counter::counts stage(stage_t stage, unsigned network = 0) const;
+  uint64_t calls(stage_t stage, unsigned network = 0) const;
+
+ private:
+  static allocation_counter::counts& last_counts();
+
+  recognition_observer* next;
+  atomic<uint64_t> allocations[STAGES_TOTAL][NETWORKS_MAX], bytes[STAGES_TOTAL][NETWORKS_MAX], stage_calls[STAGES_TOTAL][NETWORKS_MAX];
+};
+
+} // namespace nametag
+} // namespace ufal
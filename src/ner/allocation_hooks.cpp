@@ -0,0 +1,38 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+// Replacement of the global operator new and delete, counting allocations.
+// The array and nothrow forms call these. The aligned forms of C++17 are
+// not replaced, so over-aligned allocations are not counted.
+void* operator new(size_t size) {
+  auto& counts = ufal::nametag::allocation_counter::current();
+  counts.allocations++;
+  counts.bytes += size;
+
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace ufal {
+namespace nametag {
+
+static bool allocation_hooks_installed = allocation_counter::installed() = true;
+
+} // namespace nametag
+} // namespace ufal
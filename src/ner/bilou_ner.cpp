@@ -9,8 +9,10 @@
 
 #include "common.h"
 #include "bilou_ner.h"
+#include "entity_spans.h"
 #include "bilou/bilou_entity.h"
 #include "bilou/bilou_type.h"
+#include "recognition_observer.h"
 #include "tokenizer/morphodita_tokenizer_wrapper.h"
 
 namespace ufal {
@@ -24,6 +26,7 @@ bool bilou_ner::load(istream& is) {
 
   unique_ptr<tokenizer> tokenizer(new_tokenizer());
   if (!templates.load(is, nlp_pipeline(tokenizer.get(), tagger.get()))) return false;
+  templates.resolve_entities(named_entities);
 
   int stages = is.get();
   if (stages == EOF) return false;
@@ -41,56 +44,181 @@ void bilou_ner::recognize(const vector<string_piece>& forms, vector<named_entity
   // Acquire cache
   cache* c = caches.pop();
   if (!c) c = new cache();
-  auto& sentence = c->sentence;
 
-  // Tag
-  tagger->tag(forms, sentence);
+  if (c->entities.empty()) c->entities.emplace_back();
+  c->entities[0].clear();
+  recognize_sentences(&forms, c->entities.data(), 1, *c);
+  for (auto&& entity : c->entities[0])
+    entities.emplace_back(entity.start, entity.length, named_entities.name(entity.type));
+
+  caches.push(c);
+}
+
+void bilou_ner::recognize_batch(const vector<vector<string_piece>>& sentences, vector<vector<named_entity>>& entities) const {
+  entities.resize(sentences.size());
+  for (auto&& sentence_entities : entities)
+    sentence_entities.clear();
+  if (sentences.empty() || !tagger || !named_entities.size() || !networks.size()) return;
+
+  // Acquire cache
+  cache* c = caches.pop();
+  if (!c) c = new cache();
+
+  if (c->entities.size() < sentences.size()) c->entities.resize(sentences.size());
+  for (unsigned s = 0; s < sentences.size(); s++)
+    c->entities[s].clear();
+  recognize_sentences(sentences.data(), c->entities.data(), sentences.size(), *c);
+  for (unsigned s = 0; s < sentences.size(); s++)
+    for (auto&& entity : c->entities[s])
+      entities[s].emplace_back(entity.start, entity.length, named_entities.name(entity.type));
+
+  caches.push(c);
+}
+
+void bilou_ner::recognize_ids(const vector<string_piece>& forms, vector<named_entity_id>& entities) const {
+  entities.clear();
+  if (forms.empty() || !tagger || !named_entities.size() || !networks.size()) return;
+
+  // Acquire cache
+  cache* c = caches.pop();
+  if (!c) c = new cache();
+
+  recognize_sentences(&forms, &entities, 1, *c);
+
+  caches.push(c);
+}
+
+bool bilou_ner::recognize_text(string_piece text, vector<entity_span>& entities) const {
+  entities.clear();
+
+  // Acquire cache, which also contains a tokenizer
+  cache* c = caches.pop();
+  if (!c) c = new cache();
+  if (!c->tokenizer) c->tokenizer.reset(new_tokenizer());
+  if (!c->tokenizer) return caches.push(c), false;
+  if (!tagger || !named_entities.size() || !networks.size()) return caches.push(c), true;
+
+  if (c->entities.empty()) c->entities.emplace_back();
+  c->tokenizer->set_text(text, false);
+  while (c->tokenizer->next_sentence(&c->text_forms, &c->text_tokens)) {
+    if (c->text_forms.empty()) continue;
+
+    c->entities[0].clear();
+    recognize_sentences(&c->text_forms, c->entities.data(), 1, *c);
+    for (auto&& entity : c->entities[0])
+      append_entity_span(text, c->text_forms, c->text_tokens, entity.start, entity.length, named_entities.name(entity.type), entities);
+  }
+  c->tokenizer->set_text(string_piece(), false);
+
+  caches.push(c);
+  return true;
+}
 
-  if (sentence.size) {
+void bilou_ner::recognize_sentences(const vector<string_piece>* forms, vector<named_entity_id>* entities, unsigned count, cache& c) const {
+  if (c.sentences.size() < count) c.sentences.resize(count);
+  recognition_stage_timer timer;
+
+#ifdef NAMETAG_PROFILING
+  if (!c.profile) {
+    lock_guard<mutex> lock(profiles_mutex);
+    vector<string> processor_names;
+    templates.processor_names(processor_names);
+    c.owner = this;
+    c.profile.reset(new recognition_profile(recognition_profile::FEATURE_PROCESSORS + processor_names.size()));
+    profiles.push_back(c.profile.get());
+  }
+  auto previous_profile = recognition_profile::current();
+  recognition_profile::current() = c.profile.get();
+#endif
+
+  // Tag
+  for (unsigned s = 0; s < count; s++) {
+    auto& sentence = c.sentences[s];
+    NAMETAG_PROFILE_START(start);
+    if (forms[s].empty())
+      sentence.resize(0);
+    else
+      tagger->tag(forms[s], sentence);
     sentence.clear_previous_stage();
+    NAMETAG_PROFILE_ADD(recognition_profile::TAGGING, start, 1);
+  }
+  timer.finished(recognition_observer::TAGGING);
 
-    // Perform required NER stages
-    for (auto&& network : networks) {
-      sentence.clear_features();
-      sentence.clear_probabilities_local_filled();
+  // Perform required NER stages, each one on all sentences
+  for (unsigned stage = 0; stage < networks.size(); stage++) {
+    // Compute per-sentence feature templates; in later stages, only the
+    // stage-dependent features are recomputed
+    for (unsigned s = 0; s < count; s++) {
+      auto& sentence = c.sentences[s];
+      if (!sentence.size) continue;
 
-      // Compute per-sentence feature templates
-      templates.process_sentence(sentence, c->string_buffer);
+      sentence.clear_probabilities_local_filled();
+      if (stage == 0) {
+        sentence.clear_features();
+        templates.process_sentence(sentence, c.string_buffer);
+      } else {
+        templates.process_sentence_stage_dependent(sentence, c.string_buffer);
+      }
+    }
+    timer.finished(recognition_observer::FEATURES, stage);
 
-      // Sequentially classify sentence words
-      for (unsigned i = 0; i < sentence.size; i++) {
+    // Classify sentence words
+    for (unsigned s = 0; s < count; s++) {
+      auto& sentence = c.sentences[s];
+      NAMETAG_PROFILE_START(start);
+      for (unsigned i = 0; i < sentence.size; i++)
         if (!sentence.probabilities[i].local_filled) {
-          network.classify(sentence.features[i], c->outcomes, c->network_buffer);
-          fill_bilou_probabilities(c->outcomes, sentence.probabilities[i].local);
+          networks[stage].classify(sentence.features[i], c.outcomes, c.network_buffer);
+          fill_bilou_probabilities(c.outcomes, sentence.probabilities[i].local);
           sentence.probabilities[i].local_filled = true;
         }
+      NAMETAG_PROFILE_ADD(recognition_profile::CLASSIFICATION, start, sentence.size);
+    }
+    timer.finished(recognition_observer::CLASSIFICATION, stage);
 
-        if (i == 0) {
-          sentence.probabilities[i].global.init(sentence.probabilities[i].local);
-        } else {
-          sentence.probabilities[i].global.update(sentence.probabilities[i].local, sentence.probabilities[i - 1].global);
-        }
-      }
+    // Sequentially decode the best bilou sequence
+    for (unsigned s = 0; s < count; s++) {
+      auto& sentence = c.sentences[s];
+      if (!sentence.size) continue;
 
+      NAMETAG_PROFILE_START(update_start);
+      sentence.probabilities[0].global.init(sentence.probabilities[0].local);
+      for (unsigned i = 1; i < sentence.size; i++)
+        sentence.probabilities[i].global.update(sentence.probabilities[i].local, sentence.probabilities[i - 1].global);
+      NAMETAG_PROFILE_ADD(recognition_profile::GLOBAL_UPDATE, update_start, sentence.size);
+
+      NAMETAG_PROFILE_START(decoding_start);
       sentence.compute_best_decoding();
+      NAMETAG_PROFILE_ADD(recognition_profile::BEST_DECODING, decoding_start, 1);
       sentence.fill_previous_stage();
     }
+    timer.finished(recognition_observer::DECODING, stage);
+  }
+
+  for (unsigned s = 0; s < count; s++) {
+    auto& sentence = c.sentences[s];
+    if (!sentence.size) continue;
 
     // Store entities in the output array
     for (unsigned i = 0; i < sentence.size; i++)
       if (sentence.probabilities[i].global.best == bilou_type_U) {
-        entities.emplace_back(i, 1, named_entities.name(sentence.probabilities[i].global.bilou[bilou_type_U].entity));
+        entities[s].emplace_back(i, 1, sentence.probabilities[i].global.bilou[bilou_type_U].entity);
       } else if (sentence.probabilities[i].global.best == bilou_type_B) {
         unsigned start = i++;
         while (i < sentence.size && sentence.probabilities[i].global.best != bilou_type_L) i++;
-        entities.emplace_back(start, i - start + (i < sentence.size), named_entities.name(sentence.probabilities[start].global.bilou[bilou_type_B].entity));
+        entities[s].emplace_back(start, i - start + (i < sentence.size), sentence.probabilities[start].global.bilou[bilou_type_B].entity);
       }
 
     // Process the entities
-    templates.process_entities(sentence, entities, c->entities_buffer);
+    NAMETAG_PROFILE_START(start);
+    templates.process_entities(sentence, entities[s], c.entities_buffer);
+    NAMETAG_PROFILE_ADD(recognition_profile::ENTITIES, start, 1);
   }
+  timer.finished(recognition_observer::ENTITIES);
 
-  caches.push(c);
+#ifdef NAMETAG_PROFILING
+  recognition_profile::current() = previous_profile;
+#endif
 }
 
 tokenizer* bilou_ner::new_tokenizer() const {
@@ -110,6 +238,55 @@ void bilou_ner::gazetteers(vector<string>& gazetteers, vector<int>* gazetteer_ty
   templates.gazetteers(gazetteers, gazetteer_types);
 }
 
+void bilou_ner::statistics(vector<recognition_statistics>& statistics) const {
+  statistics.clear();
+
+#ifdef NAMETAG_PROFILING
+  vector<string> names = {"tagging", "classification", "decoding update", "decoding best", "entities"};
+  vector<string> processor_names;
+  templates.processor_names(processor_names);
+  for (auto&& processor_name : processor_names)
+    names.push_back("features " + processor_name);
+
+  lock_guard<mutex> lock(profiles_mutex);
+  for (unsigned part = 0; part < names.size(); part++) {
+    statistics.emplace_back(names[part], 0, 0);
+    for (auto&& profile : profiles) {
+      statistics.back().calls += profile->calls(part);
+      statistics.back().ticks += profile->ticks(part);
+    }
+    if (released_profile) {
+      statistics.back().calls += released_profile->calls(part);
+      statistics.back().ticks += released_profile->ticks(part);
+    }
+  }
+#endif
+}
+
+#ifdef NAMETAG_PROFILING
+bilou_ner::cache::~cache() {
+  if (!owner || !profile) return;
+
+  lock_guard<mutex> lock(owner->profiles_mutex);
+  if (!owner->released_profile) owner->released_profile.reset(new recognition_profile(profile->size()));
+  owner->released_profile->merge(*profile);
+  owner->profiles.erase(find(owner->profiles.begin(), owner->profiles.end(), profile.get()));
+}
+#endif
+
+void bilou_ner::memory_footprint(vector<memory_component>& components) const {
+  components.clear();
+  if (tagger) tagger->memory_footprint(components);
+  components.emplace_back("entity map", named_entities.memory_footprint(), named_entities.size());
+  templates.memory_footprint(components);
+  for (unsigned i = 0; i < networks.size(); i++)
+    networks[i].memory_footprint("network " + to_string(i + 1), components);
+}
+
+void bilou_ner::vocabulary(vector<string>& forms) const {
+  templates.vocabulary(forms);
+}
+
 void bilou_ner::fill_bilou_probabilities(const vector<double>& outcomes, bilou_probabilities& prob) {
   for (auto&& prob_bilou : prob.bilou)
     prob_bilou.probability = -1;
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "common.h"
 #include "bilou/bilou_entity.h"
 #include "classifier/network_classifier.h"
@@ -17,8 +19,9 @@
 #include "ner.h"
 #include "ner_ids.h"
 #include "tagger/tagger.h"
+#include "recognition_profile.h"
 #include "tokenizer/tokenizer.h"
-#include "utils/threadsafe_stack.h"
+#include "utils/cache_pool.h"
 
 namespace ufal {
 namespace nametag {
@@ -30,12 +33,23 @@ class bilou_ner : public ner {
   bool load(istream& is);
 
   virtual void recognize(const vector<string_piece>& forms, vector<named_entity>& entities) const override;
+  virtual void recognize_batch(const vector<vector<string_piece>>& sentences, vector<vector<named_entity>>& entities) const override;
+  virtual void recognize_ids(const vector<string_piece>& forms, vector<named_entity_id>& entities) const override;
+  virtual bool recognize_text(string_piece text, vector<entity_span>& entities) const override;
   virtual tokenizer* new_tokenizer() const override;
 
   virtual void entity_types(vector<string>& types) const override;
 
   virtual void gazetteers(vector<string>& gazetteers, vector<int>* gazetteer_types) const override;
+
+  virtual void statistics(vector<recognition_statistics>& statistics) const override;
+
+  virtual void memory_footprint(vector<memory_component>& components) const override;
+
+  // Forms known to the feature templates, used to generate synthetic data
+  void vocabulary(vector<string>& forms) const;
  private:
+  friend class bilou_ner_compactor;
   friend class bilou_ner_trainer;
 
   // Methods used by bylou_ner_trainer
@@ -50,12 +64,37 @@ class bilou_ner : public ner {
   vector<network_classifier> networks;
 
   struct cache {
-    ner_sentence sentence;
+    vector<ner_sentence> sentences;
     vector<double> outcomes, network_buffer;
     string string_buffer;
-    vector<named_entity> entities_buffer;
+    vector<named_entity_id> entities_buffer;
+    vector<vector<named_entity_id>> entities;
+
+    // Used by recognize_text
+    unique_ptr<ufal::nametag::tokenizer> tokenizer;
+    vector<string_piece> text_forms;
+    vector<token_range> text_tokens;
+#ifdef NAMETAG_PROFILING
+    // Profile of this cache, merged into the released profile of the owner
+    // when the cache is deleted
+    const bilou_ner* owner = nullptr;
+    unique_ptr<recognition_profile> profile;
+    ~cache();
+#endif
   };
-  mutable threadsafe_stack<cache> caches;
+
+#ifdef NAMETAG_PROFILING
+  // Profiles of the existing caches, each used by one thread at a time, and
+  // the sum of the profiles of the deleted caches; must outlive the caches
+  mutable mutex profiles_mutex;
+  mutable vector<recognition_profile*> profiles;
+  mutable unique_ptr<recognition_profile> released_profile;
+#endif
+  mutable cache_pool<cache> caches;
+
+  // Recognize the given sentences, appending the found entities to the
+  // entities vectors, which are expected to be empty.
+  void recognize_sentences(const vector<string_piece>* forms, vector<named_entity_id>* entities, unsigned count, cache& c) const;
 };
 
 } // namespace nametag
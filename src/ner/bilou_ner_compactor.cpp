@@ -0,0 +1,76 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <iterator>
+#include <sstream>
+
+#include "bilou_ner.h"
+#include "bilou_ner_compactor.h"
+
+namespace ufal {
+namespace nametag {
+
+void bilou_ner_compactor::compact(istream& is, ostream& os, double threshold, bool quantize, statistics& stats) {
+  // Read the whole model, so that the tagger can be copied verbatim
+  string model((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+  istringstream model_stream(model);
+
+  int id = model_stream.get();
+  if (id != ner_ids::CZECH_NER && id != ner_ids::ENGLISH_NER && id != ner_ids::GENERIC_NER)
+    runtime_failure("Unknown NER model type!");
+  bilou_ner ner((ner_id) id);
+
+  if (ner.tagger.reset(tagger::load_instance(model_stream)), !ner.tagger) runtime_failure("Cannot load the tagger of the NER model!");
+  size_t tagger_end = model_stream.tellg();
+
+  if (!ner.named_entities.load(model_stream)) runtime_failure("Cannot load the entity map of the NER model!");
+  unique_ptr<tokenizer> tokenizer(ner.new_tokenizer());
+  if (!ner.templates.load(model_stream, nlp_pipeline(tokenizer.get(), ner.tagger.get()))) runtime_failure("Cannot load the feature templates of the NER model!");
+
+  int stages = model_stream.get();
+  if (stages == EOF) runtime_failure("Cannot load the NER model!");
+  ner.networks.resize(stages);
+  for (auto&& network : ner.networks)
+    if (!network.load(model_stream)) runtime_failure("Cannot load the classifier network of the NER model!");
+
+  // Prune the weights
+  stats = statistics();
+  for (auto&& network : ner.networks) {
+    stats.weights += network.weights_count();
+    stats.pruned_weights += network.prune(threshold);
+  }
+
+  // Remove the features not used by any network
+  vector<bool> used_features;
+  for (auto&& network : ner.networks)
+    network.used_features(used_features);
+
+  vector<ner_feature> renumbering;
+  stats.features = ner.templates.get_total_features();
+  ner.templates.compact(used_features, renumbering);
+  stats.compacted_features = ner.templates.get_total_features();
+  for (auto&& network : ner.networks)
+    network.renumber_features(renumbering);
+
+  if (quantize)
+    for (auto&& network : ner.networks)
+      network.quantize();
+
+  // Save the compacted model
+  os.put(id);
+  os.write(model.data() + 1, tagger_end - 1);
+  if (!ner.named_entities.save(os)) runtime_failure("Cannot save entity map!");
+  if (!ner.templates.save(os)) runtime_failure("Cannot save feature templates!");
+  os.put(stages);
+  for (auto&& network : ner.networks)
+    if (!network.save(os)) runtime_failure("Cannot save classifier network!");
+}
+
+} // namespace nametag
+} // namespace ufal
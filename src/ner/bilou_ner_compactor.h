@@ -0,0 +1,33 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "common.h"
+#include "features/ner_feature.h"
+
+namespace ufal {
+namespace nametag {
+
+class bilou_ner_compactor {
+ public:
+  struct statistics {
+    size_t weights = 0, pruned_weights = 0;
+    ner_feature features = 0, compacted_features = 0;
+  };
+
+  // Load a bilou_ner model, remove the network weights differing from the
+  // missing weight by less than the threshold, remove the features no longer
+  // used by any network and save the compacted model, optionally with
+  // quantized network weights.
+  static void compact(istream& is, ostream& os, double threshold, bool quantize, statistics& stats);
+};
+
+} // namespace nametag
+} // namespace ufal
@@ -8,34 +8,55 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <unordered_map>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "bilou_ner.h"
 #include "bilou_ner_trainer.h"
+#include "utils/binary_decoder.h"
+#include "utils/binary_encoder.h"
+#include "utils/parallel_for.h"
+#include "utils/path_from_utf8.h"
 #include "utils/split.h"
 
 namespace ufal {
 namespace nametag {
 
-void bilou_ner_trainer::train(ner_id id, int stages, const network_parameters& parameters, const tagger& tagger,
-                              istream& features, istream& train, istream& heldout, ostream& os) {
+// Version of the tagged data cache format
+static const unsigned char tagged_cache_version = 2;
+
+void bilou_ner_trainer::train(ner_id id, int stages, const vector<network_parameters>& parameters, const tagger& tagger,
+                              istream& features, istream& train, istream& heldout, ostream& os,
+                              const training_options& options) {
+  unsigned threads = options.threads;
+
   if (stages <= 0) runtime_failure("Cannot train NER with <= 0 stages!");
   if (stages >= 256) runtime_failure("Cannot train NER with >= 256 stages!");
+  if (parameters.empty()) runtime_failure("No network parameters given!");
+  bool sweep = parameters.size() > 1;
 
   // Load training and possibly also heldout data
   entity_map entities;
   vector<labelled_sentence> train_data;
   cerr << "Loading train data: ";
-  load_data(train, tagger, train_data, entities, true);
+  load_data(train, tagger, train_data, entities, true, options);
   cerr << "done, " << train_data.size() << " sentences" << endl;
   cerr << "Found " << entities.size() << " annotated entity types." << endl;
 
   vector<labelled_sentence> heldout_data;
   if (heldout) {
     cerr << "Loading heldout data: ";
-    load_data(heldout, tagger, heldout_data, entities, false);
+    load_data(heldout, tagger, heldout_data, entities, false, options);
     cerr << "done, " << heldout_data.size() << " sentences" << endl;
   }
+  if (sweep && heldout_data.empty()) runtime_failure("Heldout data are required to choose the best network parameters!");
 
   // Parse feature templates
   feature_templates templates;
@@ -44,25 +65,105 @@ void bilou_ner_trainer::train(ner_id id, int stages, const network_parameters& p
   templates.parse(features, entities, nlp_pipeline(tokenizer.get(), &tagger));
   cerr << "done" << endl;
 
-  // Train required number of stages
-  vector<network_classifier> networks(stages);
+  // Train required number of stages for all parameter sets. The instances of
+  // the first stage are shared by all parameter sets; the later stages need
+  // the instances of every parameter set, because they depend on the outputs
+  // of the previous stages.
+  vector<vector<network_classifier>> networks(parameters.size(), vector<network_classifier>(stages));
+  vector<double> accuracies(parameters.size());
 
-  for (auto&& network : networks) {
-    // Generate features
-    cerr << "Generating features: ";
-    vector<classifier_instance> train_instances, heldout_instances;
-    generate_instances(train_data, templates, train_instances, true);
-    generate_instances(heldout_data, templates, heldout_instances, false);
-    cerr << "done" << endl;
+  for (unsigned stage = 0; stage < unsigned(stages); stage++) {
+    unsigned instance_sets = stage ? parameters.size() : 1;
+    vector<classifier_instances> train_instances(instance_sets), heldout_instances(instance_sets);
+    vector<unique_ptr<classifier_instances_file>> train_files(instance_sets);
 
-    // Train and encode the recognizer
-    cerr << "Training network classifier." << endl;
-    if (!network.train(templates.get_total_features(), bilou_entity::total(entities.size()), train_instances, heldout_instances, parameters, true))
-      runtime_failure("Cannot train the network classifier!");
+    for (unsigned set = 0; set < instance_sets; set++) {
+      // Recompute the outputs of the previous stages of this parameter set
+      if (stage && sweep) {
+        for (auto* data : {&train_data, &heldout_data})
+          for (auto&& sentence : *data)
+            sentence.sentence.clear_previous_stage();
+        for (unsigned previous = 0; previous < stage; previous++) {
+          compute_previous_stage(train_data, templates, networks[set][previous], threads);
+          compute_previous_stage(heldout_data, templates, networks[set][previous], threads);
+        }
+      }
+
+      // Generate features, possibly spilling the training instances to a file
+      cerr << "Generating features: ";
+      if (!options.spill_dir.empty()) {
+        // The process id keeps concurrent trainings with the same directory apart
+#ifdef _WIN32
+        int pid = _getpid();
+#else
+        int pid = getpid();
+#endif
+        string spill_path = options.spill_dir + "/nametag_train" + to_string(pid) + "_stage" + to_string(stage + 1) +
+            (instance_sets > 1 ? "_parameters" + to_string(set + 1) : string()) + ".instances";
+        train_files[set].reset(new classifier_instances_file());
+        if (!train_files[set]->create(spill_path)) runtime_failure("Cannot create instances file '" << spill_path << "'!");
+      }
+      generate_instances(train_data, templates, train_instances[set], true, stage > 0, threads, train_files[set].get());
+      generate_instances(heldout_data, templates, heldout_instances[set], false, stage > 0, threads);
+      if (train_files[set]) {
+        if (!train_files[set]->finish()) runtime_failure("Cannot write the training instances file!");
+        cerr << "done, " << train_files[set]->size() << " training instances spilled in " << train_files[set]->blocks() << " blocks" << endl;
+      } else {
+        cerr << "done" << endl;
+      }
+    }
+
+    // Train the network classifiers. In a sweep, the networks of individual
+    // parameter sets are trained concurrently, each using a single thread.
+    if (!sweep) {
+      cerr << "Training network classifier." << endl;
+      network_parameters stage_parameters = parameters[0];
+      stage_parameters.threads = threads;
+      if (!networks[0][stage].train(templates.get_total_features(), bilou_entity::total(entities.size()),
+                                    train_files[0] ? (const classifier_instances_source&)*train_files[0] : train_instances[0],
+                                    heldout_instances[0], stage_parameters, true))
+        runtime_failure("Cannot train the network classifier!");
+    } else {
+      cerr << "Training " << parameters.size() << " network classifiers of stage " << stage + 1 << ": ";
+      vector<char> trained(parameters.size());
+      parallel_for(parameters.size(), 1, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          unsigned set = stage ? i : 0;
+          network_parameters stage_parameters = parameters[i];
+          stage_parameters.threads = 1;
+          trained[i] = networks[i][stage].train(templates.get_total_features(), bilou_entity::total(entities.size()),
+                                                train_files[set] ? (const classifier_instances_source&)*train_files[set] : train_instances[set],
+                                                heldout_instances[set], stage_parameters, false);
+          if (trained[i] && stage + 1 == unsigned(stages))
+            accuracies[i] = networks[i][stage].accuracy(heldout_instances[set]);
+        }
+      });
+      for (auto&& network_trained : trained)
+        if (!network_trained) runtime_failure("Cannot train the network classifier!");
+      cerr << "done" << endl;
+    }
+    train_files.clear();
 
     // Use the trained classifier to compute previous_stage
-    compute_previous_stage(train_data, templates, network);
-    compute_previous_stage(heldout_data, templates, network);
+    if (!sweep) {
+      compute_previous_stage(train_data, templates, networks[0][stage], threads);
+      compute_previous_stage(heldout_data, templates, networks[0][stage], threads);
+    }
+  }
+
+  // Choose the best parameter set according to the heldout accuracy
+  unsigned best = 0;
+  if (sweep) {
+    for (unsigned i = 0; i < parameters.size(); i++) {
+      auto& p = parameters[i];
+      cerr.unsetf(ios::floatfield);
+      cerr << setprecision(6) << "Parameters " << i + 1 << ": iterations " << p.iterations << ", missing_weight " << p.missing_weight
+           << ", initial_learning_rate " << p.initial_learning_rate << ", final_learning_rate " << p.final_learning_rate
+           << ", gaussian " << p.gaussian_sigma << ", hidden_layer " << p.hidden_layer << ": heldout acc "
+           << fixed << setprecision(2) << 100. * accuracies[i] << "%" << endl;
+      if (accuracies[i] > accuracies[best]) best = i;
+    }
+    cerr << "Choosing parameters " << best + 1 << " with the best heldout accuracy." << endl;
   }
 
   // Encode the recognizer
@@ -70,107 +171,283 @@ void bilou_ner_trainer::train(ner_id id, int stages, const network_parameters& p
   if (!entities.save(os)) runtime_error("Cannot save entity map!");
   if (!templates.save(os)) runtime_error("Cannot save feature templates!");
   if (!os.put(stages)) runtime_error("Cannot save number of stages!");
-  for (auto&& network : networks)
+  for (auto&& network : networks[best])
     if (!network.save(os)) runtime_error("Cannot save classifier network!");
 }
 
-void bilou_ner_trainer::load_data(istream& is, const tagger& tagger, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities) {
-  vector<string> words, entities;
-  vector<string_piece> forms;
-
+void bilou_ner_trainer::load_data(istream& is, const tagger& tagger, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities, const training_options& options) {
+  unsigned threads = options.threads;
   data.clear();
 
+  // When caching the tagged data, the whole input is read first to compute
+  // the cache key, and the cached data are used if they exist. The lines are
+  // then read directly from the input text, which is not copied.
+  string text, cache_path;
+  size_t text_position = 0;
+  uint64_t cache_key = 0, text_length = 0;
+  ofstream cache;
+  if (!options.tagged_cache_dir.empty()) {
+    text.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+    text_length = text.size();
+
+    // Compute FNV-1a hash of the tagger key and the input data; the length
+    // of the input data is stored in the cache and compared too
+    cache_key = 14695981039346656037ULL;
+    for (auto&& chr : options.tagger_key) cache_key = (cache_key ^ (unsigned char)chr) * 1099511628211ULL;
+    cache_key = (cache_key ^ 0xFF) * 1099511628211ULL;
+    for (auto&& chr : text) cache_key = (cache_key ^ (unsigned char)chr) * 1099511628211ULL;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tagged", (unsigned long long) cache_key);
+    cache_path = options.tagged_cache_dir + "/" + name;
+    if (load_tagged_data(cache_path, cache_key, text_length, data, entity_map, add_entities)) {
+      cerr << "using cached " << cache_path << ", ";
+      return;
+    }
+    data.clear();
+
+    cache.open(path_from_utf8(cache_path + ".tmp").c_str(), ofstream::binary | ofstream::trunc);
+    if (!cache.is_open()) runtime_failure("Cannot create tagged data cache file '" << cache_path << ".tmp'!");
+    cache.write((const char*) &tagged_cache_version, 1).write((const char*) &cache_key, sizeof(cache_key)).write((const char*) &text_length, sizeof(text_length));
+  }
+  auto next_line = [&](string& line) -> bool {
+    if (!cache.is_open()) return bool(getline(is, line));
+    if (text_position >= text.size()) return false;
+
+    size_t line_end = text.find('\n', text_position);
+    if (line_end == string::npos) line_end = text.size();
+    line.assign(text, text_position, line_end - text_position);
+    text_position = line_end + 1;
+    return true;
+  };
+
+  // The sentences are read in blocks; every block is tagged in parallel and
+  // then its entities are decoded sequentially, so that the entity types
+  // are added to the entity_map in the same order as without threads.
+  const size_t block_size = threads > 1 ? 1024 * threads : 1;
+  vector<vector<string>> block_words, block_entities;
+  size_t block_sentences = 0;
+
   string line;
   vector<string> tokens;
   for (bool eof; true; ) {
-    eof = !getline(is, line);
+    eof = !next_line(line);
     if (eof || line.empty()) {
-      if (!words.empty()) {
-        // Tag the sentence
-        forms.clear();
-        for (auto&& word : words)
-          forms.emplace_back(word);
-        data.emplace_back();
-        auto& sentence = data.back();
-        tagger.tag(forms, sentence.sentence);
-
-        // Clear previous_stage
-        sentence.sentence.clear_previous_stage();
-
-        // Decode the entities names and ranges
-        for (unsigned i = 0; i < entities.size(); i++)
-          if (entities[i] == "_" || entities[i] == "O")
-            sentence.outcomes.emplace_back(bilou_entity::O);
-          else if (entities[i].size() >= 3 && (entities[i].compare(0, 2, "I-") == 0 || entities[i].compare(0, 2, "B-") == 0)) {
-            bool has_prev = i > 0 && entities[i][0] == 'I' && entities[i-1].compare(1, string::npos, entities[i], 1, string::npos) == 0;
-            bool has_next = i+1 < entities.size() && entities[i+1][0] != 'B' && entities[i+1].compare(1, string::npos, entities[i], 1, string::npos) == 0;
-            entity_type entity = entity_map.parse(entities[i].c_str() + 2, add_entities);
-            sentence.outcomes.emplace_back(!has_prev && !has_next ? bilou_entity::U(entity) : !has_prev && has_next ? bilou_entity::B(entity) : has_prev && has_next ? bilou_entity::I : bilou_entity::L);
+      if (block_sentences < block_words.size() && !block_words[block_sentences].empty())
+        block_sentences++;
+
+      if (block_sentences && (eof || block_sentences >= block_size)) {
+        size_t block_start = data.size();
+        data.resize(block_start + block_sentences);
+
+        // Tag the sentences
+        parallel_for(block_sentences, 64, threads, [&](size_t begin, size_t end) {
+          vector<string_piece> forms;
+          for (size_t s = begin; s < end; s++) {
+            forms.clear();
+            for (auto&& word : block_words[s])
+              forms.emplace_back(word);
+            tagger.tag(forms, data[block_start + s].sentence);
+
+            // Clear previous_stage
+            data[block_start + s].sentence.clear_previous_stage();
           }
-          else
-            runtime_failure("Cannot parse entity type " << entities[i] << "!");
+        });
+
+        // Decode the entities names and ranges, caching the tagged sentences
+        for (size_t s = 0; s < block_sentences; s++) {
+          decode_entities(block_entities[s], data[block_start + s], entity_map, add_entities);
+          if (cache.is_open()) save_tagged_sentence(cache, data[block_start + s], block_entities[s]);
+        }
 
-        // Start a new sentence
-        words.clear();
-        entities.clear();
+        // Start a new block
+        for (size_t s = 0; s < block_sentences; s++)
+          block_words[s].clear(), block_entities[s].clear();
+        block_sentences = 0;
       }
       if (eof) break;
     } else {
       split(line, '\t', tokens);
       if (tokens.size() != 2) runtime_failure("The NER data line '" << line << "' does not contain two columns!");
-      words.emplace_back(tokens[0]);
-      entities.emplace_back(tokens[1]);
+      if (block_sentences == block_words.size()) block_words.emplace_back(), block_entities.emplace_back();
+      block_words[block_sentences].emplace_back(tokens[0]);
+      block_entities[block_sentences].emplace_back(tokens[1]);
     }
   }
+
+  // Make the cached data available only when completely written
+  if (cache.is_open()) {
+    cache.close();
+    if (cache.fail()) runtime_failure("Cannot write tagged data cache file '" << cache_path << ".tmp'!");
+    remove_utf8(cache_path);
+    if (!rename_utf8(cache_path + ".tmp", cache_path))
+      runtime_failure("Cannot rename tagged data cache file to '" << cache_path << "'!");
+  }
 }
 
-void bilou_ner_trainer::generate_instances(vector<labelled_sentence>& data, const feature_templates& templates, vector<classifier_instance>& instances, bool add_features) {
-  string buffer;
+void bilou_ner_trainer::decode_entities(const vector<string>& entities, labelled_sentence& sentence, entity_map& entity_map, bool add_entities) {
+  sentence.outcomes.clear();
+  for (unsigned i = 0; i < entities.size(); i++)
+    if (entities[i] == "_" || entities[i] == "O")
+      sentence.outcomes.emplace_back(bilou_entity::O);
+    else if (entities[i].size() >= 3 && (entities[i].compare(0, 2, "I-") == 0 || entities[i].compare(0, 2, "B-") == 0)) {
+      bool has_prev = i > 0 && entities[i][0] == 'I' && entities[i-1].compare(1, string::npos, entities[i], 1, string::npos) == 0;
+      bool has_next = i+1 < entities.size() && entities[i+1][0] != 'B' && entities[i+1].compare(1, string::npos, entities[i], 1, string::npos) == 0;
+      entity_type entity = entity_map.parse(entities[i].c_str() + 2, add_entities);
+      sentence.outcomes.emplace_back(!has_prev && !has_next ? bilou_entity::U(entity) : !has_prev && has_next ? bilou_entity::B(entity) : has_prev && has_next ? bilou_entity::I : bilou_entity::L);
+    }
+    else
+      runtime_failure("Cannot parse entity type " << entities[i] << "!");
+}
 
-  for (auto&& sentence : data) {
-    sentence.sentence.clear_features();
-    sentence.sentence.clear_probabilities_local_filled();
+void bilou_ner_trainer::save_tagged_sentence(ostream& os, const labelled_sentence& sentence, const vector<string>& entities) {
+  binary_encoder enc;
+  enc.add_4B(sentence.sentence.size);
+  for (unsigned i = 0; i < sentence.sentence.size; i++) {
+    auto& word = sentence.sentence.words[i];
+    enc.add_str(word.form);
+    enc.add_str(word.raw_lemma);
+    enc.add_4B(word.raw_lemmas_all.size());
+    for (auto&& raw_lemma : word.raw_lemmas_all)
+      enc.add_str(raw_lemma);
+    enc.add_str(word.lemma_id);
+    enc.add_str(word.lemma_comments);
+    enc.add_str(word.tag);
+    enc.add_str(entities[i]);
+  }
 
-    // Sentence processors
-    templates.process_sentence(sentence.sentence, buffer, add_features);
+  uint32_t len = enc.data.size();
+  os.write((const char*) &len, sizeof(len)).write((const char*) enc.data.data(), len);
+}
+
+bool bilou_ner_trainer::load_tagged_data(const string& path, uint64_t key, uint64_t length, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities) {
+  ifstream is(path_from_utf8(path).c_str(), ifstream::binary);
+  if (!is.is_open()) return false;
+
+  unsigned char version;
+  uint64_t file_key, file_length;
+  if (!is.read((char*) &version, 1).read((char*) &file_key, sizeof(file_key)).read((char*) &file_length, sizeof(file_length))) return false;
+  if (version != tagged_cache_version || file_key != key || file_length != length) return false;
 
-    // Create classifier instances
-    for (unsigned i = 0; i < sentence.sentence.size; i++)
-     instances.emplace_back(sentence.sentence.features[i], sentence.outcomes[i]);
+  // The entity_map must not be modified if the cache turns out to be invalid
+  class entity_map cached_entity_map = entity_map;
+  binary_decoder data_decoder;
+  vector<string> entities;
+  try {
+    for (uint32_t len; is.read((char*) &len, sizeof(len)); ) {
+      if (!is.read((char*) data_decoder.fill(len), len)) return false;
+
+      data.emplace_back();
+      auto& sentence = data.back();
+      sentence.sentence.resize(data_decoder.next_4B());
+      entities.resize(sentence.sentence.size);
+      for (unsigned i = 0; i < sentence.sentence.size; i++) {
+        auto& word = sentence.sentence.words[i];
+        data_decoder.next_str(word.form);
+        data_decoder.next_str(word.raw_lemma);
+        word.raw_lemmas_all.resize(data_decoder.next_4B());
+        for (auto&& raw_lemma : word.raw_lemmas_all)
+          data_decoder.next_str(raw_lemma);
+        data_decoder.next_str(word.lemma_id);
+        data_decoder.next_str(word.lemma_comments);
+        data_decoder.next_str(word.tag);
+        data_decoder.next_str(entities[i]);
+      }
+      if (!data_decoder.is_end()) return false;
+      sentence.sentence.clear_previous_stage();
+      decode_entities(entities, sentence, cached_entity_map, add_entities);
+    }
+  } catch (binary_decoder_error&) {
+    return false;
   }
+  if (!is.eof()) return false;
+
+  entity_map = cached_entity_map;
+  return true;
 }
 
-void bilou_ner_trainer::compute_previous_stage(vector<labelled_sentence>& data, const feature_templates& templates, const network_classifier& network) {
-  string buffer;
-  vector<double> outcomes, network_buffer;
+void bilou_ner_trainer::generate_instances(vector<labelled_sentence>& data, const feature_templates& templates, classifier_instances& instances, bool add_features,
+                                           bool stage_dependent_only, unsigned threads, classifier_instances_file* spill) {
+  // When adding features, the sentences must be processed sequentially,
+  // so that the feature ids are assigned deterministically.
+  if (add_features) threads = 1;
 
-  for (auto&& labelled_sentence : data) {
-    auto& sentence = labelled_sentence.sentence;
+  // When spilling, the instances are written to the file in blocks of this size
+  const size_t spill_block = 1 << 16;
+  auto spill_instances = [&](bool force) {
+    if (spill && (force || instances.size() >= spill_block)) {
+      if (!spill->add_block(instances)) runtime_failure("Cannot write the training instances file!");
+      instances.clear();
+    }
+  };
 
-    sentence.clear_features();
-    sentence.clear_probabilities_local_filled();
+  const size_t chunk_size = 256;
+  vector<classifier_instances> chunk_instances(threads > 1 ? (data.size() + chunk_size - 1) / chunk_size : 0);
 
-    // Sentence processors
-    templates.process_sentence(sentence, buffer);
+  parallel_for(data.size(), chunk_size, threads, [&](size_t begin, size_t end) {
+    auto& output = threads > 1 ? chunk_instances[begin / chunk_size] : instances;
+    string buffer;
 
-    // Sequentially classify sentence words
-    for (unsigned i = 0; i < sentence.size; i++) {
-      if (!sentence.probabilities[i].local_filled) {
-        network.classify(sentence.features[i], outcomes, network_buffer);
-        bilou_ner::fill_bilou_probabilities(outcomes, sentence.probabilities[i].local);
-        sentence.probabilities[i].local_filled = true;
-      }
+    for (size_t s = begin; s < end; s++) {
+      auto& sentence = data[s];
+      sentence.sentence.clear_probabilities_local_filled();
 
-      if (i == 0) {
-        sentence.probabilities[i].global.init(sentence.probabilities[i].local);
+      // Sentence processors, recomputing only the stage-dependent ones if requested
+      if (stage_dependent_only) {
+        templates.process_sentence_stage_dependent(sentence.sentence, buffer, add_features);
       } else {
-        sentence.probabilities[i].global.update(sentence.probabilities[i].local, sentence.probabilities[i - 1].global);
+        sentence.sentence.clear_features();
+        templates.process_sentence(sentence.sentence, buffer, add_features);
       }
+
+      // Create classifier instances
+      for (unsigned i = 0; i < sentence.sentence.size; i++)
+        output.add(sentence.sentence.features[i], sentence.outcomes[i]);
+      if (threads <= 1) spill_instances(false);
     }
+  });
 
-    sentence.compute_best_decoding();
-    sentence.fill_previous_stage();
+  // Concatenate the instances of individual chunks in order
+  for (auto&& chunk : chunk_instances) {
+    instances.append(chunk);
+    chunk.clear();
+    spill_instances(false);
   }
+  spill_instances(true);
+}
+
+void bilou_ner_trainer::compute_previous_stage(vector<labelled_sentence>& data, const feature_templates& templates, const network_classifier& network, unsigned threads) {
+  parallel_for(data.size(), 64, threads, [&](size_t begin, size_t end) {
+    string buffer;
+    vector<double> outcomes, network_buffer;
+
+    for (size_t s = begin; s < end; s++) {
+      auto& sentence = data[s].sentence;
+
+      // Sentence processors; the stage-independent features were already
+      // computed by generate_instances
+      sentence.clear_probabilities_local_filled();
+      templates.process_sentence_stage_dependent(sentence, buffer);
+
+      // Sequentially classify sentence words
+      for (unsigned i = 0; i < sentence.size; i++) {
+        if (!sentence.probabilities[i].local_filled) {
+          network.classify(sentence.features[i], outcomes, network_buffer);
+          bilou_ner::fill_bilou_probabilities(outcomes, sentence.probabilities[i].local);
+          sentence.probabilities[i].local_filled = true;
+        }
+
+        if (i == 0) {
+          sentence.probabilities[i].global.init(sentence.probabilities[i].local);
+        } else {
+          sentence.probabilities[i].global.update(sentence.probabilities[i].local, sentence.probabilities[i - 1].global);
+        }
+      }
+
+      sentence.compute_best_decoding();
+      sentence.fill_previous_stage();
+    }
+  });
 }
 
 } // namespace nametag
@@ -11,6 +11,7 @@
 
 #include "common.h"
 #include "bilou/bilou_entity.h"
+#include "classifier/classifier_instances_file.h"
 #include "classifier/network_classifier.h"
 #include "entity_map.h"
 #include "features/feature_templates.h"
@@ -22,8 +23,18 @@ namespace nametag {
 
 class bilou_ner_trainer {
  public:
-  static void train(ner_id id, int stages, const network_parameters& parameters, const tagger& tagger,
-                    istream& features, istream& train, istream& heldout, ostream& os);
+  struct training_options {
+    unsigned threads = 1;
+    string spill_dir; // Directory for temporary files with training instances
+    string tagged_cache_dir; // Directory with cached tagged data
+    string tagger_key; // Identification of the tagger used in the tagged data cache
+  };
+
+  // When more network parameter sets are given, networks for all of them are
+  // trained and the one with the best heldout accuracy is saved.
+  static void train(ner_id id, int stages, const vector<network_parameters>& parameters, const tagger& tagger,
+                    istream& features, istream& train, istream& heldout, ostream& os,
+                    const training_options& options);
 
  private:
   struct labelled_sentence {
@@ -31,9 +42,13 @@ class bilou_ner_trainer {
     vector<bilou_entity::value> outcomes;
   };
 
-  static void load_data(istream& is, const tagger& tagger, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities);
-  static void generate_instances(vector<labelled_sentence>& data, const feature_templates& templates, vector<classifier_instance>& instances, bool add_features);
-  static void compute_previous_stage(vector<labelled_sentence>& data, const feature_templates& templates, const network_classifier& network);
+  static void load_data(istream& is, const tagger& tagger, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities, const training_options& options);
+  static void decode_entities(const vector<string>& entities, labelled_sentence& sentence, entity_map& entity_map, bool add_entities);
+  static void save_tagged_sentence(ostream& os, const labelled_sentence& sentence, const vector<string>& entities);
+  static bool load_tagged_data(const string& path, uint64_t key, uint64_t length, vector<labelled_sentence>& data, entity_map& entity_map, bool add_entities);
+  static void generate_instances(vector<labelled_sentence>& data, const feature_templates& templates, classifier_instances& instances, bool add_features,
+                                 bool stage_dependent_only, unsigned threads, classifier_instances_file* spill = nullptr);
+  static void compute_previous_stage(vector<labelled_sentence>& data, const feature_templates& templates, const network_classifier& network, unsigned threads);
 };
 
 } // namespace nametag
@@ -8,6 +8,7 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "entity_map.h"
+#include "memory_footprint.h"
 #include "utils/binary_decoder.h"
 #include "utils/compressor.h"
 
@@ -49,5 +50,9 @@ entity_type entity_map::size() const {
   return id2str.size();
 }
 
+size_t entity_map::memory_footprint() const {
+  return ufal::nametag::memory_footprint(str2id) + ufal::nametag::memory_footprint(id2str);
+}
+
 } // namespace nametag
 } // namespace ufal
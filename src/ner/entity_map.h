@@ -26,6 +26,7 @@ class entity_map {
   bool save(ostream& os) const;
 
   entity_type size() const;
+  size_t memory_footprint() const;
  private:
   mutable unordered_map<string, entity_type> str2id;
   mutable vector<string> id2str;
@@ -0,0 +1,31 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "common.h"
+#include "ner.h"
+#include "tokenizer/tokenizer.h"
+
+namespace ufal {
+namespace nametag {
+
+// Append an entity spanning the given tokens of a sentence of the text.
+// The forms must point into the text, as returned by a tokenizer
+// with make_copy set to false.
+inline void append_entity_span(string_piece text, const vector<string_piece>& forms, const vector<token_range>& tokens,
+                               size_t start, size_t length, const string& type, vector<entity_span>& entities) {
+  const string_piece& first = forms[start], & last = forms[start + length - 1];
+  const token_range& first_token = tokens[start], & last_token = tokens[start + length - 1];
+  entities.emplace_back(first.str - text.str, last.str + last.len - first.str,
+                        first_token.start, last_token.start + last_token.length - first_token.start, type);
+}
+
+} // namespace nametag
+} // namespace ufal
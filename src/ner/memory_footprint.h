@@ -0,0 +1,73 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <type_traits>
+#include <unordered_map>
+
+#include "common.h"
+
+namespace ufal {
+namespace nametag {
+
+// Approximate number of bytes allocated on heap by standard containers and
+// their elements. Hash tables are assumed to allocate a pointer per bucket and
+// a node with a pointer and a cached hash per element.
+inline size_t memory_footprint(const string& str);
+template <class T> inline size_t memory_footprint(const T& value);
+template <class T, class U> inline size_t memory_footprint(const pair<T, U>& value);
+template <class T> inline size_t memory_footprint(const vector<T>& values);
+template <class K, class V> inline size_t memory_footprint(const unordered_map<K, V>& map);
+template <class K, class V> inline size_t memory_footprint(const unordered_multimap<K, V>& map);
+
+size_t memory_footprint(const string& str) {
+  static const size_t inline_capacity = string().capacity();
+  return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+template <class T>
+size_t memory_footprint(const T& /*value*/) {
+  return 0;
+}
+
+template <class T, class U>
+size_t memory_footprint(const pair<T, U>& value) {
+  return memory_footprint(value.first) + memory_footprint(value.second);
+}
+
+template <class T>
+size_t memory_footprint(const vector<T>& values) {
+  size_t bytes = values.capacity() * sizeof(T);
+  if (!is_scalar<T>::value)
+    for (auto&& value : values)
+      bytes += memory_footprint(value);
+  return bytes;
+}
+
+template <class Map>
+inline size_t hash_table_memory_footprint(const Map& map) {
+  size_t bytes = map.bucket_count() * sizeof(void*) + map.size() * (sizeof(typename Map::value_type) + sizeof(void*) + sizeof(size_t));
+  for (auto&& element : map)
+    bytes += memory_footprint(element.first) + memory_footprint(element.second);
+  return bytes;
+}
+
+template <class K, class V>
+size_t memory_footprint(const unordered_map<K, V>& map) {
+  return hash_table_memory_footprint(map);
+}
+
+template <class K, class V>
+size_t memory_footprint(const unordered_multimap<K, V>& map) {
+  return hash_table_memory_footprint(map);
+}
+
+} // namespace nametag
+} // namespace ufal
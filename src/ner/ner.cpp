@@ -7,9 +7,11 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
 #include <fstream>
 
 #include "bilou_ner.h"
+#include "entity_spans.h"
 #include "ner.h"
 #include "ner_ids.h"
 #include "utils/path_from_utf8.h"
@@ -40,5 +42,50 @@ ner* ner::load(const char* fname) {
   return load(in);
 }
 
+void ner::recognize_batch(const vector<vector<string_piece>>& sentences, vector<vector<named_entity>>& entities) const {
+  entities.resize(sentences.size());
+  for (size_t i = 0; i < sentences.size(); i++)
+    recognize(sentences[i], entities[i]);
+}
+
+bool ner::recognize_text(string_piece text, vector<entity_span>& entities) const {
+  entities.clear();
+
+  unique_ptr<tokenizer> tokenizer(new_tokenizer());
+  if (!tokenizer) return false;
+
+  vector<string_piece> forms;
+  vector<token_range> tokens;
+  vector<named_entity> sentence_entities;
+  tokenizer->set_text(text, false);
+  while (tokenizer->next_sentence(&forms, &tokens)) {
+    recognize(forms, sentence_entities);
+    for (auto&& entity : sentence_entities)
+      append_entity_span(text, forms, tokens, entity.start, entity.length, entity.type, entities);
+  }
+
+  return true;
+}
+
+void ner::statistics(vector<recognition_statistics>& statistics) const {
+  statistics.clear();
+}
+
+void ner::memory_footprint(vector<memory_component>& components) const {
+  components.clear();
+}
+
+void ner::recognize_ids(const vector<string_piece>& forms, vector<named_entity_id>& entities) const {
+  vector<named_entity> named_entities;
+  recognize(forms, named_entities);
+
+  vector<string> types;
+  entity_types(types);
+
+  entities.clear();
+  for (auto&& entity : named_entities)
+    entities.emplace_back(entity.start, entity.length, find(types.begin(), types.end(), entity.type) - types.begin());
+}
+
 } // namespace nametag
 } // namespace ufal
@@ -24,6 +24,56 @@ struct named_entity {
   named_entity(size_t start, size_t length, const string& type) : start(start), length(length), type(type) {}
 };
 
+// Named entity with the type represented by its index in the types
+// returned by ner::entity_types, which avoids allocating a string per entity.
+struct named_entity_id {
+  size_t start;
+  size_t length;
+  unsigned type;
+
+  named_entity_id() {}
+  named_entity_id(size_t start, size_t length, unsigned type) : start(start), length(length), type(type) {}
+};
+
+// Named entity found in an untokenized text. The start and length are
+// measured in bytes of the UTF-8 text, the char_start and char_length
+// in Unicode characters.
+struct entity_span {
+  size_t start;
+  size_t length;
+  size_t char_start;
+  size_t char_length;
+  string type;
+
+  entity_span() {}
+  entity_span(size_t start, size_t length, size_t char_start, size_t char_length, const string& type)
+      : start(start), length(length), char_start(char_start), char_length(char_length), type(type) {}
+};
+
+// Profiling statistics of a part of the recognition. The ticks are CPU
+// timestamp counter cycles on x86 and nanoseconds elsewhere.
+struct recognition_statistics {
+  string name;
+  unsigned long long calls;
+  unsigned long long ticks;
+
+  recognition_statistics() {}
+  recognition_statistics(const string& name, unsigned long long calls, unsigned long long ticks) : name(name), calls(calls), ticks(ticks) {}
+};
+
+// Memory allocated by a component of the recognizer. The entries are the
+// number of keys, rows or weights of the component, when applicable.
+struct memory_component {
+  string name;
+  size_t bytes;
+  size_t entries;
+  string details;
+
+  memory_component() : bytes(0), entries(0) {}
+  memory_component(const string& name, size_t bytes, size_t entries = 0, const string& details = string())
+      : name(name), bytes(bytes), entries(entries), details(details) {}
+};
+
 class ner {
  public:
   virtual ~ner() {}
@@ -44,6 +94,27 @@ class ner {
   // Construct a new tokenizer instance appropriate for this recognizer.
   // Can return NULL if no such tokenizer exists.
   virtual tokenizer* new_tokenizer() const = 0;
+
+  // Perform named entity recognition on several tokenized sentences at once,
+  // which can be faster than recognizing them one by one.
+  virtual void recognize_batch(const vector<vector<string_piece>>& sentences, vector<vector<named_entity>>& entities) const;
+
+  // Tokenize the given text using a tokenizer of this recognizer and return
+  // the entities found in it. Returns false if no such tokenizer exists.
+  virtual bool recognize_text(string_piece text, vector<entity_span>& entities) const;
+
+  // Return the profiling statistics gathered by all threads using this
+  // recognizer. The statistics are gathered only when NameTag is compiled
+  // with NAMETAG_PROFILING defined, otherwise they are empty.
+  virtual void statistics(vector<recognition_statistics>& statistics) const;
+
+  // Return the memory allocated by the individual components of the
+  // recognizer, i.e., the tagger, the feature templates and the networks.
+  virtual void memory_footprint(vector<memory_component>& components) const;
+
+  // Perform named entity recognition on a tokenized sentence, returning
+  // the entity types as indices into the types returned by entity_types.
+  virtual void recognize_ids(const vector<string_piece>& forms, vector<named_entity_id>& entities) const;
 };
 
 } // namespace nametag
@@ -0,0 +1,65 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <chrono>
+
+#include "common.h"
+
+namespace ufal {
+namespace nametag {
+
+// Observer of the recognition stages performed by the current thread.
+// When no observer is installed, the recognizers do not measure anything.
+class recognition_observer {
+ public:
+  virtual ~recognition_observer() {}
+
+  enum stage_t { TAGGING, FEATURES, CLASSIFICATION, DECODING, ENTITIES, STAGES_TOTAL };
+
+  // Called when a recognition of a sentence (or a batch) starts.
+  virtual void recognition_started() {}
+
+  // Called when a recognition stage finishes. The network is the index of the
+  // NER stage for FEATURES, CLASSIFICATION and DECODING, zero otherwise.
+  virtual void stage_finished(stage_t stage, unsigned network, double seconds) = 0;
+
+  // Observer installed for the current thread, nullptr if none.
+  static inline recognition_observer*& current() {
+    static thread_local recognition_observer* observer = nullptr;
+    return observer;
+  }
+};
+
+// Helper measuring consecutive stages for the observer of the current thread.
+class recognition_stage_timer {
+ public:
+  recognition_stage_timer() : observer(recognition_observer::current()) {
+    if (!observer) return;
+
+    observer->recognition_started();
+    start = chrono::steady_clock::now();
+  }
+
+  inline void finished(recognition_observer::stage_t stage, unsigned network = 0) {
+    if (!observer) return;
+
+    auto now = chrono::steady_clock::now();
+    observer->stage_finished(stage, network, chrono::duration<double>(now - start).count());
+    start = now;
+  }
+
+ private:
+  recognition_observer* observer;
+  chrono::steady_clock::time_point start;
+};
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,87 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "common.h"
+
+namespace ufal {
+namespace nametag {
+
+#ifdef NAMETAG_PROFILING
+// The timestamp counter intrinsic is declared here instead of including
+// the platform-specific headers, so that the sources can be merged.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+extern "C" unsigned __int64 __rdtsc();
+#pragma intrinsic(__rdtsc)
+#endif
+
+// Per-thread profile of the recognition, counting calls and clock ticks of
+// the profiled parts. Only the owning thread updates the counters, so no
+// atomic read-modify-write operations are needed.
+class recognition_profile {
+ public:
+  enum { TAGGING, CLASSIFICATION, GLOBAL_UPDATE, BEST_DECODING, ENTITIES, FEATURE_PROCESSORS };
+
+  recognition_profile(unsigned parts) : parts(parts), counters(new atomic<uint64_t>[2 * parts]) {
+    for (unsigned i = 0; i < 2 * parts; i++)
+      counters[i].store(0, memory_order_relaxed);
+  }
+
+  // CPU timestamp counter on x86, nanoseconds elsewhere.
+  static inline uint64_t now() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  inline void add(unsigned part, uint64_t start, uint64_t calls = 1) {
+    if (part >= parts) return;
+    uint64_t end = now();
+    counters[2 * part].store(counters[2 * part].load(memory_order_relaxed) + calls, memory_order_relaxed);
+    counters[2 * part + 1].store(counters[2 * part + 1].load(memory_order_relaxed) + end - start, memory_order_relaxed);
+  }
+
+  // Add the counters of another profile, which must not be in use.
+  inline void merge(const recognition_profile& other) {
+    for (unsigned i = 0; i < 2 * parts && i < 2 * other.parts; i++)
+      counters[i].store(counters[i].load(memory_order_relaxed) + other.counters[i].load(memory_order_relaxed), memory_order_relaxed);
+  }
+
+  unsigned size() const { return parts; }
+  uint64_t calls(unsigned part) const { return part < parts ? counters[2 * part].load(memory_order_relaxed) : 0; }
+  uint64_t ticks(unsigned part) const { return part < parts ? counters[2 * part + 1].load(memory_order_relaxed) : 0; }
+
+  // Profile used by the current thread, nullptr if none.
+  static inline recognition_profile*& current() {
+    static thread_local recognition_profile* profile = nullptr;
+    return profile;
+  }
+
+ private:
+  unsigned parts;
+  unique_ptr<atomic<uint64_t>[]> counters;
+};
+
+#define NAMETAG_PROFILE_START(Start) uint64_t Start = recognition_profile::now()
+#define NAMETAG_PROFILE_ADD(Part, Start, Calls) { auto _profile = recognition_profile::current(); if (_profile) _profile->add((Part), (Start), (Calls)); }
+#else
+#define NAMETAG_PROFILE_START(Start)
+#define NAMETAG_PROFILE_ADD(Part, Start, Calls)
+#endif
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,114 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdio>
+
+#include "recognition_trace.h"
+#include "utils/path_from_utf8.h"
+
+namespace ufal {
+namespace nametag {
+
+const char* recognition_trace::stage_names[STAGES_TOTAL] = {"tagging", "features", "classification", "decoding", "entities"};
+
+recognition_trace::recognition_trace() : id(0) {}
+
+recognition_trace::~recognition_trace() {
+  close();
+}
+
+bool recognition_trace::open(const string& file_name, const string& process_name) {
+  close();
+
+  file.open(path_from_utf8(file_name).c_str(), ofstream::binary);
+  if (!file) return false;
+
+  // A new id invalidates the events cached by the threads for previous files.
+  static atomic<unsigned> ids(0);
+  id = ++ids;
+
+  // The process metadata comes first, so that every event can start with a comma.
+  file << "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"";
+  for (auto&& chr : process_name)
+    if (chr == '"' || chr == '\\') file << '\\' << chr;
+    else if ((unsigned char)chr >= 0x20) file << chr;
+  file << "\"}}";
+
+  origin = chrono::steady_clock::now();
+  return bool(file);
+}
+
+bool recognition_trace::close() {
+  lock_guard<mutex> lock(file_mutex);
+  if (!file.is_open()) return true;
+
+  for (auto&& thread : threads)
+    file << thread->events;
+  threads.clear();
+
+  file << "\n]\n";
+  file.close();
+  return bool(file);
+}
+
+void recognition_trace::span(const char* name, const char* category, chrono::steady_clock::time_point start,
+                             chrono::steady_clock::time_point end, unsigned network) {
+  if (!file.is_open()) return;
+
+  auto& thread = current_thread();
+  char event[256];
+  int length = snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                        name, category, thread.tid,
+                        chrono::duration<double, micro>(start - origin).count(),
+                        chrono::duration<double, micro>(end - start).count());
+  if (length < 0 || length >= int(sizeof(event))) return;
+  if (network)
+    length += snprintf(event + length, sizeof(event) - length, ",\"args\":{\"network\":%u}}", network);
+  else
+    length += snprintf(event + length, sizeof(event) - length, "}");
+  if (length >= int(sizeof(event))) return;
+
+  thread.events.append(event, length);
+  if (thread.events.size() >= FLUSH_SIZE) write(thread);
+}
+
+void recognition_trace::span(const char* name, const char* category, double seconds, unsigned network) {
+  auto end = chrono::steady_clock::now();
+  span(name, category, end - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds)), end, network);
+}
+
+void recognition_trace::stage_finished(stage_t stage, unsigned network, double seconds) {
+  bool per_network = stage == FEATURES || stage == CLASSIFICATION || stage == DECODING;
+  span(stage_names[stage], "recognition", seconds, per_network ? network + 1 : 0);
+}
+
+recognition_trace::thread_events& recognition_trace::current_thread() {
+  // The events of a thread are owned by the trace, the thread only caches them.
+  static thread_local unsigned cached_id = 0;
+  static thread_local thread_events* cached_events = nullptr;
+
+  if (cached_id != id) {
+    lock_guard<mutex> lock(file_mutex);
+    static atomic<unsigned> tids(0);
+    threads.emplace_back(new thread_events());
+    threads.back()->tid = ++tids;
+    cached_events = threads.back().get();
+    cached_id = id;
+  }
+  return *cached_events;
+}
+
+void recognition_trace::write(thread_events& thread) {
+  lock_guard<mutex> lock(file_mutex);
+  file << thread.events;
+  thread.events.clear();
+}
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,87 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+#include "common.h"
+#include "recognition_observer.h"
+
+namespace ufal {
+namespace nametag {
+
+// Recorder of spans in the Chrome trace-event JSON format, which can be opened
+// in chrome://tracing or Perfetto. Every thread buffers its own events and
+// appends them to the file in large blocks, so that tracing does not
+// serialize the traced threads. When installed as the recognition observer,
+// the recognition stages are recorded too.
+class recognition_trace : public recognition_observer {
+ public:
+  recognition_trace();
+  virtual ~recognition_trace() override;
+
+  bool open(const string& file_name, const string& process_name);
+  // Must not be called while other threads are still recording spans.
+  bool close();
+  inline bool is_open() const { return file.is_open(); }
+
+  // Record a span of the current thread. The name and the category are
+  // written verbatim, so they must not require JSON escaping. The network
+  // is one-based and is omitted from the event when zero.
+  void span(const char* name, const char* category, chrono::steady_clock::time_point start,
+            chrono::steady_clock::time_point end, unsigned network = 0);
+  // Record a span of the current thread ending now and lasting given time.
+  void span(const char* name, const char* category, double seconds, unsigned network = 0);
+
+  virtual void stage_finished(stage_t stage, unsigned network, double seconds) override;
+
+  // Helper recording consecutive spans, doing nothing when trace is nullptr.
+  class timer {
+   public:
+    timer(recognition_trace* trace) : trace(trace) {
+      if (trace) start = chrono::steady_clock::now();
+    }
+
+    inline void finished(const char* name, const char* category) {
+      if (!trace) return;
+
+      auto now = chrono::steady_clock::now();
+      trace->span(name, category, start, now);
+      start = now;
+    }
+
+   private:
+    recognition_trace* trace;
+    chrono::steady_clock::time_point start;
+  };
+
+ private:
+  struct thread_events {
+    unsigned tid;
+    string events;
+  };
+  thread_events& current_thread();
+  void write(thread_events& thread);
+
+  enum { FLUSH_SIZE = 64 << 10 };
+  static const char* stage_names[STAGES_TOTAL];
+
+  unsigned id;
+  chrono::steady_clock::time_point origin;
+  mutex file_mutex;
+  ofstream file;
+  vector<unique_ptr<thread_events>> threads;
+};
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,131 @@
+// This file is part of MicroRestD <http://github.com/ufal/microrestd/>.
+//
+// Copyright 2015 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "async_log_writer.h"
+
+namespace ufal {
+namespace microrestd {
+
+using namespace std;
+
+async_log_writer::async_log_writer(ostream* log_file, unsigned capacity)
+  : log_file(log_file), enqueue_position(0), dequeue_position(0), dropped_lines(0), stopping(false), writer_waiting(false) {
+  // Round the capacity up to a power of two
+  size_t size = 2;
+  while (size < capacity) size <<= 1;
+
+  slots.reset(new slot[size]);
+  mask = size - 1;
+  for (size_t i = 0; i < size; i++)
+    slots[i].sequence.store(i, memory_order_relaxed);
+
+  writer_thread = thread(&async_log_writer::writer, this);
+}
+
+async_log_writer::~async_log_writer() {
+  stopping.store(true, memory_order_release);
+  {
+    lock_guard<mutex> lock(writer_mutex);
+    writer_wakeup.notify_one();
+  }
+  writer_thread.join();
+}
+
+uint64_t async_log_writer::dropped() const {
+  return dropped_lines.load(memory_order_relaxed);
+}
+
+// The ring buffer is a bounded multi-producer queue by Dmitry Vyukov; every slot
+// sequence indicates whether the slot is free for the given enqueue position or
+// filled for the given dequeue position.
+bool async_log_writer::push(string&& line) {
+  size_t position = enqueue_position.load(memory_order_relaxed);
+  for (slot* current;;) {
+    current = &slots[position & mask];
+    size_t sequence = current->sequence.load(memory_order_acquire);
+    intptr_t difference = intptr_t(sequence) - intptr_t(position);
+    if (difference == 0) {
+      if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+        current->line.swap(line);
+        current->sequence.store(position + 1, memory_order_release);
+        wake_writer();
+        return true;
+      }
+    } else if (difference < 0) {
+      dropped_lines.fetch_add(1, memory_order_relaxed);
+      wake_writer();
+      return false;
+    } else {
+      position = enqueue_position.load(memory_order_relaxed);
+    }
+  }
+}
+
+// The writer announces it is going to sleep in writer_waiting and then checks
+// the buffer again; the fences guarantee that either the writer finds the new
+// message, or the producer finds the writer waiting and wakes it up.
+void async_log_writer::wake_writer() {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (writer_waiting.load(memory_order_relaxed)) {
+    lock_guard<mutex> lock(writer_mutex);
+    writer_wakeup.notify_one();
+  }
+}
+
+bool async_log_writer::poppable() const {
+  return slots[dequeue_position & mask].sequence.load(memory_order_acquire) == dequeue_position + 1;
+}
+
+bool async_log_writer::pop(string& line) {
+  if (!poppable()) return false;
+  slot* current = &slots[dequeue_position & mask];
+
+  line.swap(current->line);
+  current->line.clear();
+  current->sequence.store(dequeue_position + mask + 1, memory_order_release);
+  dequeue_position++;
+  return true;
+}
+
+void async_log_writer::writer() {
+  string line;
+  uint64_t reported_dropped = 0;
+
+  while (true) {
+    bool stop = stopping.load(memory_order_acquire);
+
+    bool written = false;
+    while (pop(line)) {
+      *log_file << line << '\n';
+      written = true;
+    }
+
+    uint64_t dropped = dropped_lines.load(memory_order_relaxed);
+    if (dropped != reported_dropped) {
+      *log_file << "Log buffer full, dropped " << dropped - reported_dropped << " messages (" << dropped << " in total).\n";
+      reported_dropped = dropped;
+      written = true;
+    }
+
+    if (written) log_file->flush();
+    if (stop) break;
+    if (!written) {
+      unique_lock<mutex> lock(writer_mutex);
+      writer_waiting.store(true, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      writer_wakeup.wait(lock, [this, reported_dropped] {
+        return stopping.load(memory_order_acquire) || poppable() || dropped_lines.load(memory_order_relaxed) != reported_dropped;
+      });
+      writer_waiting.store(false, memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace microrestd
+} // namespace ufal
@@ -0,0 +1,64 @@
+// This file is part of MicroRestD <http://github.com/ufal/microrestd/>.
+//
+// Copyright 2015 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace ufal {
+namespace microrestd {
+
+// Writes log messages to a stream using a background thread. The messages are
+// passed through a bounded lock-free ring buffer, so that the logging threads
+// never block; when the buffer is full, the message is dropped and counted.
+// When the buffer is empty, the background thread sleeps until woken up by
+// the next message.
+class async_log_writer {
+ public:
+  async_log_writer(std::ostream* log_file, unsigned capacity);
+  ~async_log_writer();
+
+  // Enqueue a complete log line (without the newline). Never blocks.
+  bool push(std::string&& line);
+
+  uint64_t dropped() const;
+
+ private:
+  struct slot {
+    std::atomic<size_t> sequence;
+    std::string line;
+  };
+
+  bool pop(std::string& line);
+  bool poppable() const;
+  void wake_writer();
+  void writer();
+
+  std::ostream* log_file;
+  std::unique_ptr<slot[]> slots;
+  size_t mask;
+  std::atomic<size_t> enqueue_position;
+  size_t dequeue_position;
+  std::atomic<uint64_t> dropped_lines;
+  std::atomic<bool> stopping;
+  std::atomic<bool> writer_waiting;
+  std::mutex writer_mutex;
+  std::condition_variable writer_wakeup;
+  std::thread writer_thread;
+};
+
+} // namespace microrestd
+} // namespace ufal
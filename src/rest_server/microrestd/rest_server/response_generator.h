@@ -21,6 +21,14 @@ class response_generator {
   virtual bool generate() = 0;
   virtual string_piece current() const = 0;
   virtual void consume(size_t length) = 0;
+
+  // Return true if the generation was cancelled by the generator. In that case
+  // the connection is closed without completing the response.
+  virtual bool cancelled() const { return false; }
+
+  // Called when the response cannot be completed, because the client closed
+  // the connection or the connection failed or timed out.
+  virtual void abandoned() {}
 };
 
 } // namespace microrestd
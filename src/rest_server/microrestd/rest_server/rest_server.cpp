@@ -12,6 +12,7 @@
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <thread>
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
@@ -62,6 +63,7 @@ class rest_server::microhttpd_request : public rest_request {
 
   int handle(rest_service* service);
   bool process_request_body(const char* request_body, size_t request_body_len);
+  void completed(int toe);
 
   const sockaddr* address() const;
   const char* forwarded_for() const;
@@ -98,6 +100,7 @@ class rest_server::microhttpd_request : public rest_request {
   static int get_iterator(void* cls, MHD_ValueKind kind, const char* key, const char* value);
   static int post_iterator(void* cls, MHD_ValueKind kind, const char* key, const char* filename, const char* content_type, const char* transfer_encoding, const char* data, uint64_t off, size_t size);
   static ssize_t generator_callback(void* cls, uint64_t pos, char* buf, size_t max);
+  void abandon_generator();
 
   static bool valid_utf8(const string& text);
 
@@ -197,6 +200,10 @@ bool rest_server::microhttpd_request::process_request_body(const char* request_b
   return true;
 }
 
+void rest_server::microhttpd_request::completed(int toe) {
+  if (toe != MHD_REQUEST_TERMINATED_COMPLETED_OK) abandon_generator();
+}
+
 const sockaddr* rest_server::microhttpd_request::address() const {
   auto info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
   return info ? info->client_addr : nullptr;
@@ -312,6 +319,9 @@ ssize_t rest_server::microhttpd_request::generator_callback(void* cls, uint64_t
     data = request->generator->current();
   }
 
+  // Was the generation cancelled?
+  if (request->generator_end && request->generator->cancelled()) return MHD_CONTENT_READER_END_WITH_ERROR;
+
   // End of data?
   if (data.len <= request->generator_offset) return MHD_CONTENT_READER_END_OF_STREAM;
 
@@ -326,6 +336,13 @@ ssize_t rest_server::microhttpd_request::generator_callback(void* cls, uint64_t
   return data_len;
 }
 
+void rest_server::microhttpd_request::abandon_generator() {
+  if (generator && !generator_end) {
+    generator_end = true;
+    generator->abandoned();
+  }
+}
+
 bool rest_server::microhttpd_request::valid_utf8(const string& text) {
   for (auto str = (const unsigned char*) text.c_str(); *str; str++)
     if (*str >= 0x80) {
@@ -371,6 +388,9 @@ void rest_server::set_log_file(ostream* log_file, unsigned max_log_size) {
   this->log_file = log_file;
   this->max_log_size = max_log_size;
 }
+void rest_server::set_log_async(unsigned log_async_capacity) { this->log_async_capacity = log_async_capacity; }
+void rest_server::set_log_sampling(unsigned log_sampling) { this->log_sampling = log_sampling ? log_sampling : 1; }
+uint64_t rest_server::log_dropped() const { return log_writer ? log_writer->dropped() : 0; }
 void rest_server::set_min_generated(unsigned min_generated) { this->min_generated = min_generated; }
 void rest_server::set_max_connections(unsigned max_connections) { this->max_connections = max_connections; }
 void rest_server::set_max_request_body_size(unsigned max_request_body_size) { this->max_request_body_size = max_request_body_size; }
@@ -383,6 +403,8 @@ bool rest_server::start(rest_service* service, unsigned port) {
 
   if (!microhttpd_request::initialize()) return false;
 
+  if (log_file && log_async_capacity) log_writer.reset(new async_log_writer(log_file, log_async_capacity));
+
   for (int use_poll = 1; use_poll >= 0; use_poll--) {
     MHD_OptionItem threadpool_size[] = {
       { threads ? MHD_OPTION_THREAD_POOL_SIZE : MHD_OPTION_END, int(threads), nullptr },
@@ -409,6 +431,7 @@ bool rest_server::start(rest_service* service, unsigned port) {
     }
   }
 
+  log_writer.reset();
   return false;
 }
 
@@ -430,6 +453,7 @@ void rest_server::stop() {
   MHD_stop_daemon(daemon);
   daemon = nullptr;
   service = nullptr;
+  log_writer.reset();
   log_file = nullptr;
 }
 
@@ -520,9 +544,12 @@ int rest_server::handle_request(void* cls, struct MHD_Connection* connection, co
   return request->handle(self->service) ? MHD_YES : MHD_NO;
 }
 
-void rest_server::request_completed(void* /*cls*/, struct MHD_Connection* /*connection*/, void** con_cls, int /*toe*/) {
-  auto request = (const microhttpd_request*) *con_cls;
-  if (request) delete request;
+void rest_server::request_completed(void* /*cls*/, struct MHD_Connection* /*connection*/, void** con_cls, int toe) {
+  auto request = (microhttpd_request*) *con_cls;
+  if (request) {
+    request->completed(toe);
+    delete request;
+  }
 }
 
 template <typename... Args> void rest_server::log(Args&&... args) {
@@ -540,20 +567,29 @@ template <typename... Args> void rest_server::log(Args&&... args) {
 #endif
   size_t len = strftime(timestamp, sizeof(timestamp), "%a %d. %b %Y %H:%M:%S\t", &tm_now);
 
+  // Format the message and pass it to the asynchronous writer
+  if (log_writer) {
+    ostringstream line;
+    if (len) line << timestamp;
+    log_append(line, std::forward<Args>(args)...);
+    log_writer->push(line.str());
+    return;
+  }
+
   // Locked using the log_file_mutex
   {
     lock_guard<decltype(log_file_mutex)> log_file_lock(log_file_mutex);
 
     if (len) *log_file << timestamp;
-    log_append(std::forward<Args>(args)...);
+    log_append(*log_file, std::forward<Args>(args)...);
     *log_file << endl;
   }
 }
 
-void rest_server::log_append() {}
-template <typename Arg, typename... Args> void rest_server::log_append(Arg&& arg, Args&&... args) {
-  *log_file << arg;
-  log_append(std::forward<Args>(args)...);
+void rest_server::log_append(ostream& /*os*/) {}
+template <typename Arg, typename... Args> void rest_server::log_append(ostream& os, Arg&& arg, Args&&... args) {
+  os << arg;
+  log_append(os, std::forward<Args>(args)...);
 }
 
 void rest_server::log_append_pair(string& message, const char* key, const string& value) {
@@ -595,6 +631,7 @@ void rest_server::log_append_pair(string& message, const char* key, const string
 
 void rest_server::log_request(const microhttpd_request* request) {
   if (!log_file) return;
+  if (log_sampling > 1 && log_sampling_counter.fetch_add(1, memory_order_relaxed) % log_sampling) return;
 
   auto sock_addr = request->address();
   char address[64] = "";
@@ -9,10 +9,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
 
+#include "async_log_writer.h"
 #include "rest_request.h"
 #include "rest_service.h"
 
@@ -28,6 +31,11 @@ struct MHD_Connection;
 class rest_server {
  public:
   void set_log_file(std::ostream* log_file, unsigned max_log_size = 0);
+  // Log asynchronously using a buffer of given number of messages, 0 means synchronous logging.
+  void set_log_async(unsigned log_async_capacity);
+  // Log only one in log_sampling requests.
+  void set_log_sampling(unsigned log_sampling);
+  uint64_t log_dropped() const;
   void set_min_generated(unsigned min_generated);
   void set_max_connections(unsigned max_connections);
   void set_max_request_body_size(unsigned max_request_body_size);
@@ -45,8 +53,8 @@ class rest_server {
   static void request_completed(void* cls, libmicrohttpd::MHD_Connection* connection, void** con_cls, int toe);
 
   template<typename... Args> void log(Args&&... args);
-  void log_append();
-  template<typename Arg, typename... Args> void log_append(Arg&& arg, Args&&... args);
+  void log_append(std::ostream& os);
+  template<typename Arg, typename... Args> void log_append(std::ostream& os, Arg&& arg, Args&&... args);
   void log_append_pair(std::string& message, const char* key, const std::string& value);
   void log_request(const microhttpd_request* request);
 
@@ -56,6 +64,10 @@ class rest_server {
   std::ostream* log_file = nullptr;
   std::mutex log_file_mutex;
   unsigned max_log_size = 0;
+  unsigned log_async_capacity = 0;
+  std::unique_ptr<async_log_writer> log_writer;
+  unsigned log_sampling = 1;
+  std::atomic<unsigned> log_sampling_counter{0};
 
   unsigned min_generated = 1 << 10;
   unsigned max_connections = 0;
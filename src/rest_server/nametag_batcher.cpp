@@ -0,0 +1,75 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+
+#include "nametag_batcher.h"
+
+namespace ufal {
+namespace nametag {
+
+nametag_batcher::nametag_batcher(const ner* recognizer, unsigned max_batch_size, unsigned max_wait, nametag_metrics* metrics)
+  : recognizer(recognizer), max_batch_size(max_batch_size), max_wait(max_wait), metrics(metrics), collecting(false) {}
+
+void nametag_batcher::recognize(const vector<string_piece>& forms, vector<named_entity>& entities) {
+  if (max_batch_size <= 1) {
+    if (metrics) metrics->batch(1);
+    return recognizer->recognize(forms, entities);
+  }
+
+  request current = {&forms, &entities, false};
+  vector<request*> batch;
+  vector<vector<string_piece>> batch_forms;
+  vector<vector<named_entity>> batch_entities;
+
+  if (metrics) metrics->batch_waiting(1);
+  unique_lock<mutex> lock(batch_mutex);
+  pending.push_back(&current);
+  if (metrics) metrics->batch_pending(1);
+  if (collecting && pending.size() >= max_batch_size) batch_changed.notify_all();
+
+  while (!current.done) {
+    if (collecting) {
+      batch_changed.wait(lock);
+      continue;
+    }
+
+    // Become the leader and collect the batch
+    collecting = true;
+    auto deadline = chrono::steady_clock::now() + chrono::microseconds(max_wait);
+    while (pending.size() < max_batch_size && batch_changed.wait_until(lock, deadline) != cv_status::timeout) {}
+
+    batch.clear();
+    while (!pending.empty() && batch.size() < max_batch_size)
+      batch.push_back(pending.front()), pending.pop_front();
+    if (metrics) metrics->batch_pending(-int(batch.size()));
+    collecting = false;
+    if (!pending.empty()) batch_changed.notify_all();
+    lock.unlock();
+
+    // Recognize the batch without holding the lock
+    batch_forms.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); i++)
+      batch_forms[i] = *batch[i]->forms;
+    recognizer->recognize_batch(batch_forms, batch_entities);
+    for (size_t i = 0; i < batch.size(); i++)
+      batch[i]->entities->swap(batch_entities[i]);
+    if (metrics) metrics->batch(batch.size());
+
+    lock.lock();
+    for (auto&& request : batch)
+      request->done = true;
+    batch_changed.notify_all();
+  }
+  lock.unlock();
+  if (metrics) metrics->batch_waiting(-1);
+}
+
+} // namespace nametag
+} // namespace ufal
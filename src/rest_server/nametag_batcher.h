@@ -0,0 +1,55 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "common.h"
+#include "nametag_metrics.h"
+#include "ner/ner.h"
+
+namespace ufal {
+namespace nametag {
+
+// Coalesces sentences recognized concurrently by several threads into batches
+// processed by a single ner::recognize_batch call.
+//
+// The first thread arriving when no batch is being collected becomes the leader.
+// It waits at most max_wait microseconds (or until max_batch_size sentences are
+// pending), then takes the pending sentences and recognizes them, while the
+// other threads wait for their results. Sentences arriving during recognition
+// are collected into the next batch by a new leader.
+class nametag_batcher {
+ public:
+  nametag_batcher(const ner* recognizer, unsigned max_batch_size, unsigned max_wait, nametag_metrics* metrics);
+
+  void recognize(const vector<string_piece>& forms, vector<named_entity>& entities);
+
+ private:
+  struct request {
+    const vector<string_piece>* forms;
+    vector<named_entity>* entities;
+    bool done;
+  };
+
+  const ner* recognizer;
+  unsigned max_batch_size, max_wait;
+  nametag_metrics* metrics;
+
+  mutex batch_mutex;
+  condition_variable batch_changed;
+  deque<request*> pending;
+  bool collecting;
+};
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,255 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdio>
+
+#include "nametag_metrics.h"
+#include "utils/cache_pool.h"
+
+namespace ufal {
+namespace nametag {
+
+// Class metrics_histogram
+metrics_histogram::metrics_histogram(const uint64_t* bounds, unsigned bounds_size)
+  : bounds(bounds), bounds_size(bounds_size), buckets(new atomic<uint64_t>[bounds_size + 1]), sum(0) {
+  for (unsigned i = 0; i <= bounds_size; i++)
+    buckets[i].store(0, memory_order_relaxed);
+}
+
+void metrics_histogram::observe(uint64_t value) {
+  unsigned bucket = 0;
+  while (bucket < bounds_size && value > bounds[bucket]) bucket++;
+
+  buckets[bucket].fetch_add(1, memory_order_relaxed);
+  sum.fetch_add(value, memory_order_relaxed);
+}
+
+uint64_t metrics_histogram::count() const {
+  uint64_t count = 0;
+  for (unsigned i = 0; i <= bounds_size; i++)
+    count += buckets[i].load(memory_order_relaxed);
+  return count;
+}
+
+void metrics_histogram::write(string& output, const char* name, const string& labels, double scale) const {
+  char number[64];
+
+  uint64_t cumulative = 0;
+  for (unsigned i = 0; i <= bounds_size; i++) {
+    cumulative += buckets[i].load(memory_order_relaxed);
+    output.append(name).append("_bucket{").append(labels).append(labels.empty() ? "" : ",").append("le=\"");
+    if (i < bounds_size)
+      snprintf(number, sizeof(number), "%g", bounds[i] * scale), output.append(number);
+    else
+      output.append("+Inf");
+    snprintf(number, sizeof(number), "\"} %llu\n", (unsigned long long) cumulative);
+    output.append(number);
+  }
+
+  snprintf(number, sizeof(number), " %g\n", sum.load(memory_order_relaxed) * scale);
+  output.append(name).append("_sum").append(labels.empty() ? "" : "{").append(labels).append(labels.empty() ? "" : "}").append(number);
+  snprintf(number, sizeof(number), " %llu\n", (unsigned long long) cumulative);
+  output.append(name).append("_count").append(labels.empty() ? "" : "{").append(labels).append(labels.empty() ? "" : "}").append(number);
+}
+
+// Class nametag_metrics
+const uint64_t nametag_metrics::latency_bounds[] = {
+  // Nanoseconds, from 1us to 10s
+  1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+  1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+  1000000000, 2500000000, 5000000000, 10000000000,
+};
+const unsigned nametag_metrics::latency_bounds_size = sizeof(latency_bounds) / sizeof(*latency_bounds);
+
+const uint64_t nametag_metrics::body_bounds[] = {
+  // Bytes, from 64B to 16MB
+  64, 256, 1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20, 16 << 20,
+};
+const unsigned nametag_metrics::body_bounds_size = sizeof(body_bounds) / sizeof(*body_bounds);
+
+const uint64_t nametag_metrics::batch_bounds[] = {
+  // Sentences, from 1 to 256
+  1, 2, 4, 8, 16, 32, 64, 128, 256,
+};
+const unsigned nametag_metrics::batch_bounds_size = sizeof(batch_bounds) / sizeof(*batch_bounds);
+
+const char* nametag_metrics::handler_names[HANDLERS_TOTAL] = {"models", "recognize", "tokenize", "metrics", "other"};
+const char* nametag_metrics::cancel_names[CANCELS_TOTAL] = {"deadline", "disconnect"};
+const char* nametag_metrics::stage_names[STAGES_TOTAL] = {
+  "normalization", "tokenization", "tagging", "features", "classification", "decoding", "entities", "response"
+};
+
+nametag_metrics::nametag_metrics() : generators_running(0), batch_pending_sentences(0), batch_waiting_requests(0), batches(batch_bounds, batch_bounds_size), trace(nullptr), server(nullptr) {
+  for (int handler = 0; handler < HANDLERS_TOTAL; handler++) {
+    requests[handler].store(0, memory_order_relaxed);
+    request_errors[handler].store(0, memory_order_relaxed);
+    request_bodies.emplace_back(new metrics_histogram(body_bounds, body_bounds_size));
+  }
+
+  for (int reason = 0; reason < CANCELS_TOTAL; reason++)
+    cancelled[reason].store(0, memory_order_relaxed);
+
+  stages.resize(STAGES_TOTAL);
+  for (int stage = 0; stage < STAGES_TOTAL; stage++)
+    for (unsigned network = 0; network < (stage_per_network(stage_t(stage)) ? unsigned(NETWORKS_MAX) : 1U); network++)
+      stages[stage].emplace_back(new metrics_histogram(latency_bounds, latency_bounds_size));
+}
+
+bool nametag_metrics::stage_per_network(stage_t stage) {
+  return stage == FEATURES || stage == CLASSIFICATION || stage == DECODING;
+}
+
+void nametag_metrics::request(handler_t handler) {
+  requests[handler].fetch_add(1, memory_order_relaxed);
+}
+
+void nametag_metrics::request_error(handler_t handler) {
+  request_errors[handler].fetch_add(1, memory_order_relaxed);
+}
+
+void nametag_metrics::request_body(handler_t handler, size_t bytes) {
+  request_bodies[handler]->observe(bytes);
+}
+
+void nametag_metrics::generator_started() {
+  generators_running.fetch_add(1, memory_order_relaxed);
+}
+
+void nametag_metrics::generator_finished() {
+  generators_running.fetch_sub(1, memory_order_relaxed);
+}
+
+void nametag_metrics::generator_cancelled(cancel_t reason) {
+  cancelled[reason].fetch_add(1, memory_order_relaxed);
+}
+
+void nametag_metrics::stage(stage_t stage, unsigned network, double seconds) {
+  auto& histograms = stages[stage];
+  histograms[network < histograms.size() ? network : histograms.size() - 1]->observe(uint64_t(seconds * 1e9));
+
+  if (trace) trace->span(stage_names[stage], "request", seconds, stage_per_network(stage) ? network + 1 : 0);
+}
+
+void nametag_metrics::batch(unsigned sentences) {
+  batches.observe(sentences);
+}
+
+void nametag_metrics::batch_pending(int sentences) {
+  batch_pending_sentences.fetch_add(sentences, memory_order_relaxed);
+}
+
+void nametag_metrics::batch_waiting(int requests) {
+  batch_waiting_requests.fetch_add(requests, memory_order_relaxed);
+}
+
+void nametag_metrics::set_trace(recognition_trace* trace) {
+  this->trace = trace;
+}
+
+void nametag_metrics::set_server(const ufal::microrestd::rest_server* server) {
+  this->server = server;
+}
+
+void nametag_metrics::stage_finished(recognition_observer::stage_t stage, unsigned network, double seconds) {
+  switch (stage) {
+    case recognition_observer::TAGGING: this->stage(TAGGING, network, seconds); break;
+    case recognition_observer::FEATURES: this->stage(FEATURES, network, seconds); break;
+    case recognition_observer::CLASSIFICATION: this->stage(CLASSIFICATION, network, seconds); break;
+    case recognition_observer::DECODING: this->stage(DECODING, network, seconds); break;
+    case recognition_observer::ENTITIES: this->stage(ENTITIES, network, seconds); break;
+    case recognition_observer::STAGES_TOTAL: break;
+  }
+}
+
+void nametag_metrics::write(string& output) const {
+  char number[64];
+  string labels;
+
+  output.append("# HELP nametag_requests_total Number of handled requests.\n"
+                "# TYPE nametag_requests_total counter\n");
+  for (int handler = 0; handler < HANDLERS_TOTAL; handler++) {
+    snprintf(number, sizeof(number), "\"} %llu\n", (unsigned long long) requests[handler].load(memory_order_relaxed));
+    output.append("nametag_requests_total{handler=\"").append(handler_names[handler]).append(number);
+  }
+
+  output.append("# HELP nametag_request_errors_total Number of requests answered with an error.\n"
+                "# TYPE nametag_request_errors_total counter\n");
+  for (int handler = 0; handler < HANDLERS_TOTAL; handler++) {
+    snprintf(number, sizeof(number), "\"} %llu\n", (unsigned long long) request_errors[handler].load(memory_order_relaxed));
+    output.append("nametag_request_errors_total{handler=\"").append(handler_names[handler]).append(number);
+  }
+
+  output.append("# HELP nametag_request_body_bytes Size of the data of processed requests.\n"
+                "# TYPE nametag_request_body_bytes histogram\n");
+  for (int handler = 0; handler < HANDLERS_TOTAL; handler++)
+    if (request_bodies[handler]->count())
+      request_bodies[handler]->write(output, "nametag_request_body_bytes", labels.assign("handler=\"").append(handler_names[handler]).append("\""), 1.);
+
+  output.append("# HELP nametag_stage_seconds Duration of the processing stages of the requests.\n"
+                "# TYPE nametag_stage_seconds histogram\n");
+  for (int stage = 0; stage < STAGES_TOTAL; stage++)
+    for (unsigned network = 0; network < stages[stage].size(); network++)
+      if (stages[stage][network]->count()) {
+        labels.assign("stage=\"").append(stage_names[stage]).append("\"");
+        if (stage_per_network(stage_t(stage))) labels.append(",network=\"").append(to_string(network + 1)).append("\"");
+        stages[stage][network]->write(output, "nametag_stage_seconds", labels, 1e-9);
+      }
+
+  output.append("# HELP nametag_responses_cancelled_total Number of responses abandoned before completion.\n"
+                "# TYPE nametag_responses_cancelled_total counter\n");
+  for (int reason = 0; reason < CANCELS_TOTAL; reason++) {
+    snprintf(number, sizeof(number), "\"} %llu\n", (unsigned long long) cancelled[reason].load(memory_order_relaxed));
+    output.append("nametag_responses_cancelled_total{reason=\"").append(cancel_names[reason]).append(number);
+  }
+
+  output.append("# HELP nametag_batch_sentences Number of sentences recognized together in one batch.\n"
+                "# TYPE nametag_batch_sentences histogram\n");
+  batches.write(output, "nametag_batch_sentences", string(), 1.);
+
+  output.append("# HELP nametag_responses_in_progress Number of responses being generated.\n"
+                "# TYPE nametag_responses_in_progress gauge\n");
+  output.append("nametag_responses_in_progress ").append(to_string(generators_running.load(memory_order_relaxed))).append("\n");
+
+  output.append("# HELP nametag_batch_pending_sentences Number of sentences waiting to be collected into a batch.\n"
+                "# TYPE nametag_batch_pending_sentences gauge\n");
+  output.append("nametag_batch_pending_sentences ").append(to_string(batch_pending_sentences.load(memory_order_relaxed))).append("\n");
+
+  output.append("# HELP nametag_batch_waiting_requests Number of requests waiting in the batchers for their entities.\n"
+                "# TYPE nametag_batch_waiting_requests gauge\n");
+  output.append("nametag_batch_waiting_requests ").append(to_string(batch_waiting_requests.load(memory_order_relaxed))).append("\n");
+
+  cache_pool_statistics pools;
+  cache_pool_base::statistics_all(pools);
+
+  output.append("# HELP nametag_cache_pool_objects Number of cached objects stored in the cache pools.\n"
+                "# TYPE nametag_cache_pool_objects gauge\n");
+  output.append("nametag_cache_pool_objects ").append(to_string(pools.stored)).append("\n");
+
+  output.append("# HELP nametag_cache_pool_pops_total Number of cache pool requests, by the slot which served them.\n"
+                "# TYPE nametag_cache_pool_pops_total counter\n");
+  output.append("nametag_cache_pool_pops_total{slot=\"own\"} ").append(to_string(pools.hits)).append("\n");
+  output.append("nametag_cache_pool_pops_total{slot=\"other\"} ").append(to_string(pools.steals)).append("\n");
+
+  output.append("# HELP nametag_cache_pool_misses_total Number of cache pool requests which found the pool empty.\n"
+                "# TYPE nametag_cache_pool_misses_total counter\n");
+  output.append("nametag_cache_pool_misses_total ").append(to_string(pools.misses)).append("\n");
+
+  output.append("# HELP nametag_cache_pool_trimmed_total Number of cached objects deleted by the trim policy.\n"
+                "# TYPE nametag_cache_pool_trimmed_total counter\n");
+  output.append("nametag_cache_pool_trimmed_total ").append(to_string(pools.trimmed)).append("\n");
+
+  if (server) {
+    output.append("# HELP nametag_log_dropped_total Number of log messages dropped because the asynchronous log buffer was full.\n"
+                  "# TYPE nametag_log_dropped_total counter\n");
+    output.append("nametag_log_dropped_total ").append(to_string(server->log_dropped())).append("\n");
+  }
+}
+
+} // namespace nametag
+} // namespace ufal
@@ -0,0 +1,110 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "common.h"
+#include "microrestd/microrestd.h"
+#include "ner/recognition_observer.h"
+#include "ner/recognition_trace.h"
+
+namespace ufal {
+namespace nametag {
+
+// Histogram with fixed bucket bounds, which can be updated without locking.
+class metrics_histogram {
+ public:
+  metrics_histogram(const uint64_t* bounds, unsigned bounds_size);
+
+  void observe(uint64_t value);
+  uint64_t count() const;
+
+  // Append the histogram in Prometheus text format, multiplying values by scale.
+  void write(string& output, const char* name, const string& labels, double scale) const;
+
+ private:
+  const uint64_t* bounds;
+  unsigned bounds_size;
+  unique_ptr<atomic<uint64_t>[]> buckets;
+  atomic<uint64_t> sum;
+};
+
+// Metrics of the NameTag REST service, exported in Prometheus text format.
+// All metrics are updated lock-free, so they can be used on the hot path.
+class nametag_metrics : public recognition_observer {
+ public:
+  nametag_metrics();
+
+  enum handler_t { MODELS, RECOGNIZE, TOKENIZE, METRICS, OTHER, HANDLERS_TOTAL };
+  enum cancel_t { DEADLINE, DISCONNECT, CANCELS_TOTAL };
+  enum stage_t { NORMALIZATION, TOKENIZATION, TAGGING, FEATURES, CLASSIFICATION, DECODING, ENTITIES, RESPONSE, STAGES_TOTAL };
+
+  void request(handler_t handler);
+  void request_error(handler_t handler);
+  void request_body(handler_t handler, size_t bytes);
+  void generator_started();
+  void generator_finished();
+  void generator_cancelled(cancel_t reason);
+  void stage(stage_t stage, unsigned network, double seconds);
+  void batch(unsigned sentences);
+  // Changes of the number of sentences waiting to be batched and of the
+  // number of requests waiting in the batchers for their results.
+  void batch_pending(int sentences);
+  void batch_waiting(int requests);
+
+  // When a trace is set, all stages are also recorded as its spans.
+  void set_trace(recognition_trace* trace);
+  // When a server is set, its dropped log messages are also exported.
+  void set_server(const ufal::microrestd::rest_server* server);
+
+  virtual void stage_finished(recognition_observer::stage_t stage, unsigned network, double seconds) override;
+
+  void write(string& output) const;
+
+  // Helper measuring consecutive stages of a request.
+  class timer {
+   public:
+    timer(nametag_metrics* metrics) : metrics(metrics), start(chrono::steady_clock::now()) {}
+
+    inline void finished(stage_t stage, unsigned network = 0) {
+      auto now = chrono::steady_clock::now();
+      metrics->stage(stage, network, chrono::duration<double>(now - start).count());
+      start = now;
+    }
+    inline void restart() { start = chrono::steady_clock::now(); }
+
+   private:
+    nametag_metrics* metrics;
+    chrono::steady_clock::time_point start;
+  };
+
+ private:
+  enum { NETWORKS_MAX = 256 };
+  static const uint64_t latency_bounds[], body_bounds[], batch_bounds[];
+  static const unsigned latency_bounds_size, body_bounds_size, batch_bounds_size;
+  static const char* handler_names[HANDLERS_TOTAL];
+  static const char* cancel_names[CANCELS_TOTAL];
+  static const char* stage_names[STAGES_TOTAL];
+  static bool stage_per_network(stage_t stage);
+
+  atomic<uint64_t> requests[HANDLERS_TOTAL], request_errors[HANDLERS_TOTAL];
+  vector<unique_ptr<metrics_histogram>> request_bodies;
+  atomic<int64_t> generators_running, batch_pending_sentences, batch_waiting_requests;
+  atomic<uint64_t> cancelled[CANCELS_TOTAL];
+  vector<vector<unique_ptr<metrics_histogram>>> stages;
+  metrics_histogram batches;
+  recognition_trace* trace;
+  const ufal::microrestd::rest_server* server;
+};
+
+} // namespace nametag
+} // namespace ufal
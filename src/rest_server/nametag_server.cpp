@@ -7,13 +7,18 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "common.h"
 #include "nametag_service.h"
+#include "utils/cache_pool.h"
 #include "utils/iostreams.h"
 #include "utils/options.h"
+#include "utils/parse_double.h"
 #include "utils/parse_int.h"
 #include "utils/path_from_utf8.h"
 #include "version/version.h"
@@ -60,25 +65,41 @@ int main(int argc, char* argv[]) {
   iostreams_init();
 
   options::map options;
-  if (!options::parse({{"connection_timeout", options::value::any},
+  if (!options::parse({{"batch_size", options::value::any},
+                       {"batch_wait", options::value::any},
+                       {"cache_pool_max_idle", options::value::any},
+                       {"cache_pool_max_objects", options::value::any},
+                       {"connection_timeout", options::value::any},
                        {"daemon", options::value::none},
+                       {"log_async", options::value::any},
                        {"log_file", options::value::any},
                        {"log_request_max_size", options::value::any},
+                       {"log_sampling", options::value::any},
+                       {"max_deadline", options::value::any},
                        {"max_connections", options::value::any},
                        {"max_request_size", options::value::any},
                        {"threads", options::value::any},
+                       {"trace", options::value::any},
                        {"version", options::value::none},
                        {"help", options::value::none}}, argc, argv, options) ||
       options.count("help") ||
       ((argc < 2 || (argc % 3) != 2) && !options.count("version")))
     runtime_failure("Usage: " << argv[0] << " [options] port (model_name model_file acknowledgements)*\n"
-                    "Options: --connection_timeout=maximum connection timeout [s] (default 60)\n"
+                    "Options: --batch_size=maximum sentences recognized in one batch (default 1 means no batching)\n"
+                    "         --batch_wait=maximum wait for a batch to fill [us] (default 0)\n"
+                    "         --cache_pool_max_idle=delete cached objects unused for given time [s] (default 0 means never)\n"
+                    "         --cache_pool_max_objects=maximum cached objects per pool (default 0 means unlimited)\n"
+                    "         --connection_timeout=maximum connection timeout [s] (default 60)\n"
                     "         --daemon (daemonize after start, supported on Linux only)\n"
+                    "         --log_async=log buffer size [messages] (0 means synchronous logging, default 0)\n"
                     "         --log_file=file path (no logging if empty, default nametag_server.log)\n"
                     "         --log_request_max_size=max req log size [kB] (0 unlimited, default 64)\n"
+                    "         --log_sampling=log only one in given number of requests (default 1)\n"
                     "         --max_connections=maximum network connections (default 256)\n"
+                    "         --max_deadline=maximum request processing time [ms] (default 0 means unlimited)\n"
                     "         --max_request_size=maximum request size [kB] (default 1024)\n"
                     "         --threads=threads to use (default 0 means unlimitted)\n"
+                    "         --trace=file for Chrome trace events of the processing, written on exit\n"
                     "         --version\n"
                     "         --help");
   if (options.count("version")) {
@@ -90,8 +111,15 @@ int main(int argc, char* argv[]) {
 
   // Process options
   int port = parse_int(argv[1], "port number");
+  int batch_size = options.count("batch_size") ? parse_int(options["batch_size"], "batch size") : 1;
+  int batch_wait = options.count("batch_wait") ? parse_int(options["batch_wait"], "batch wait") : 0;
+  double cache_pool_max_idle = options.count("cache_pool_max_idle") ? parse_double(options["cache_pool_max_idle"], "cache pool maximum idle time") : 0;
+  int cache_pool_max_objects = options.count("cache_pool_max_objects") ? parse_int(options["cache_pool_max_objects"], "cache pool maximum objects") : 0;
+  int max_deadline = options.count("max_deadline") ? parse_int(options["max_deadline"], "maximum deadline") : 0;
   int connection_timeout = options.count("connection_timeout") ? parse_int(options["connection_timeout"], "connection timeout") : 60;
+  int log_async = options.count("log_async") ? parse_int(options["log_async"], "log buffer size") : 0;
   int log_request_max_size = options.count("log_request_max_size") ? parse_int(options["log_request_max_size"], "log request maximum size") : 64;
+  int log_sampling = options.count("log_sampling") ? parse_int(options["log_sampling"], "log sampling") : 1;
   int max_connections = options.count("max_connections") ? parse_int(options["max_connections"], "maximum connections") : 256;
   int max_request_size = options.count("max_request_size") ? parse_int(options["max_request_size"], "maximum request size") : 1024;
   int threads = options.count("threads") ? parse_int(options["threads"], "number of threads") : 0;
@@ -105,7 +133,27 @@ int main(int argc, char* argv[]) {
   for (int i = 2; i < argc; i += 3)
     models.emplace_back(argv[i], argv[i + 1], argv[i + 2]);
 
-  if (!service.init(models))
+  nametag_service::service_options service_options;
+  if (batch_size < 1) runtime_failure("The batch size must be positive!");
+  if (batch_wait < 0) runtime_failure("The batch wait must not be negative!");
+  if (max_deadline < 0) runtime_failure("The maximum deadline must not be negative!");
+  if (log_async < 0) runtime_failure("The log buffer size must not be negative!");
+  if (log_sampling < 1) runtime_failure("The log sampling must be positive!");
+  if (cache_pool_max_idle < 0) runtime_failure("The cache pool maximum idle time must not be negative!");
+  if (cache_pool_max_objects < 0) runtime_failure("The cache pool maximum objects must not be negative!");
+  cache_pool_base::set_trim_policy(cache_pool_max_objects, cache_pool_max_idle);
+  service_options.batch_size = batch_size;
+  service_options.batch_wait = batch_wait;
+  service_options.max_deadline = max_deadline;
+  service_options.server = &server;
+
+  recognition_trace trace;
+  if (options.count("trace")) {
+    if (!trace.open(options["trace"], "nametag_server")) runtime_failure("Cannot open trace file '" << options["trace"] << "' for writing!");
+    service_options.trace = &trace;
+  }
+
+  if (!service.init(models, service_options))
     runtime_failure("Cannot load specified models!");
 
   // Open log file
@@ -132,6 +180,8 @@ int main(int argc, char* argv[]) {
   // Start the server
   if (!log_file_name.empty())
     server.set_log_file(&log_file, log_request_max_size << 10);
+  server.set_log_async(log_async);
+  server.set_log_sampling(log_sampling);
   server.set_max_connections(max_connections);
   server.set_max_request_body_size(max_request_size << 10);
   server.set_min_generated(32 << 10);
@@ -143,9 +193,33 @@ int main(int argc, char* argv[]) {
 
   cerr << "Successfully started nametag_server on port " << port << "." << endl;
 
+  // Trim the idle cached objects periodically, even when no requests arrive
+  mutex trimmer_mutex;
+  condition_variable trimmer_wakeup;
+  bool trimmer_finished = false;
+  thread trimmer;
+  if (cache_pool_max_idle > 0)
+    trimmer = thread([&]() {
+      unique_lock<mutex> lock(trimmer_mutex);
+      while (!trimmer_wakeup.wait_for(lock, chrono::duration<double>(cache_pool_max_idle / 2), [&]{ return trimmer_finished; }))
+        cache_pool_base::trim_all();
+    });
+
   // Wait until finished
   server.wait_until_signalled();
   server.stop();
 
+  if (trimmer.joinable()) {
+    {
+      lock_guard<mutex> lock(trimmer_mutex);
+      trimmer_finished = true;
+    }
+    trimmer_wakeup.notify_one();
+    trimmer.join();
+  }
+
+  if (trace.is_open() && !trace.close())
+    runtime_failure("Cannot write trace file '" << options["trace"] << "'!");
+
   return 0;
 }
@@ -13,13 +13,17 @@
 #include "unilib/unicode.h"
 #include "unilib/uninorms.h"
 #include "unilib/utf8.h"
+#include "utils/parse_int.h"
 
 namespace ufal {
 namespace nametag {
 
 // Init the NameTag service -- load the models
-bool nametag_service::init(const vector<model_description>& model_descriptions) {
+bool nametag_service::init(const vector<model_description>& model_descriptions, const service_options& options) {
   if (model_descriptions.empty()) return false;
+  this->options = options;
+  metrics.set_trace(options.trace);
+  metrics.set_server(options.server);
 
   // Load models
   models.clear();
@@ -30,6 +34,7 @@ bool nametag_service::init(const vector<model_description>& model_descriptions)
 
     // Store the model
     models.emplace_back(model_description.rest_id, ner, model_description.acknowledgements);
+    models.back().batcher.reset(new nametag_batcher(ner, options.batch_size, options.batch_wait, &metrics));
   }
 
   // Fill rest_models_map with model name and aliases
@@ -74,11 +79,14 @@ unordered_map<string, bool (nametag_service::*)(microrestd::rest_request&)> name
   {"/models", &nametag_service::handle_rest_models},
   {"/recognize", &nametag_service::handle_rest_recognize},
   {"/tokenize", &nametag_service::handle_rest_tokenize},
+  // Metrics
+  {"/metrics", &nametag_service::handle_metrics},
 };
 
 // Handle a request using the specified URL/handler map
 bool nametag_service::handle(microrestd::rest_request& req) {
   auto handler_it = handlers.find(req.url);
+  if (handler_it == handlers.end()) metrics.request(nametag_metrics::OTHER);
   return handler_it == handlers.end() ? req.respond_not_found() : (this->*handler_it->second)(req);
 }
 
@@ -96,22 +104,36 @@ inline microrestd::string_piece sp(string_piece str) { return microrestd::string
 inline microrestd::string_piece sp(const char* str, size_t len) { return microrestd::string_piece(str, len); }
 
 const char* nametag_service::json_mime = "application/json";
+const char* nametag_service::metrics_mime = "text/plain; version=0.0.4";
 const char* nametag_service::operation_not_supported = "Required operation is not supported by the chosen model.\n";
 const char* nametag_service::infclen_header = "X-Billing-Input-NFC-Len";
 
-nametag_service::rest_response_generator::rest_response_generator(const model_info* model, rest_output_mode output)
-  : first(true), last(false), output(output) {
+nametag_service::rest_response_generator::rest_response_generator(const model_info* model, rest_output_mode output, deadline_t deadline, nametag_metrics* metrics)
+  : first(true), last(false), deadline_exceeded(false), output(output), deadline(deadline), metrics(metrics) {
+  metrics->generator_started();
+
   json.object();
   json.indent().key("model").indent().value(model->rest_id);
   json.indent().key("acknowledgements").indent().array();
   json.indent().value("http://ufal.mff.cuni.cz/nametag/1#nametag_acknowledgements");
   if (!model->acknowledgements.empty()) json.indent().value(model->acknowledgements);
   json.indent().close().indent().key("result").indent();
+  if (output.mode == ENTITIES) json.object().key(output.token_offsets ? "tokens" : "entities").array();
+}
+
+nametag_service::rest_response_generator::~rest_response_generator() {
+  metrics->generator_finished();
 }
 
 bool nametag_service::rest_response_generator::generate() {
   if (last) return false;
 
+  if (deadline != deadline_t::max() && chrono::steady_clock::now() >= deadline) {
+    metrics->generator_cancelled(nametag_metrics::DEADLINE);
+    deadline_exceeded = true;
+    return false;
+  }
+
   if (!next(first)) {
     json.finish(true);
     last = true;
@@ -120,33 +142,47 @@ bool nametag_service::rest_response_generator::generate() {
   return true;
 }
 
+bool nametag_service::rest_response_generator::cancelled() const {
+  return deadline_exceeded;
+}
+
+void nametag_service::rest_response_generator::abandoned() {
+  metrics->generator_cancelled(nametag_metrics::DISCONNECT);
+}
+
 bool nametag_service::rest_output_mode::parse(const string& str, rest_output_mode& output) {
   if (str.compare("xml") == 0) return output.mode = XML, true;
   if (str.compare("vertical") == 0) return output.mode = VERTICAL, true;
   if (str.compare("conll") == 0) return output.mode = CONLL, true;
+  if (str.compare("entities") == 0) return output.mode = ENTITIES, true;
   return false;
 }
 
 // REST service handlers
 
 bool nametag_service::handle_rest_models(microrestd::rest_request& req) {
+  metrics.request(nametag_metrics::MODELS);
   return req.respond(json_mime, json_models);
 }
 
 bool nametag_service::handle_rest_recognize(microrestd::rest_request& req) {
+  const auto handler = nametag_metrics::RECOGNIZE;
+  metrics.request(handler);
+
   string error;
   auto rest_id = get_rest_model_id(req);
   auto model = load_rest_model(rest_id, error);
-  if (!model) return req.respond_error(error);
+  if (!model) return respond_error(req, handler, error);
 
-  string data; int infclen; if (!get_data(req, data, infclen, error)) return req.respond_error(error);
-  unique_ptr<Tokenizer> tokenizer(get_tokenizer(req, model, error)); if (!tokenizer) return req.respond_error(error);
-  rest_output_mode output(XML); if (!get_output_mode(req, output, error)) return req.respond_error(error);
+  rest_response_generator::deadline_t deadline; if (!get_deadline(req, deadline, error)) return respond_error(req, handler, error);
+  string data; int infclen; if (!get_data(req, handler, data, infclen, error)) return respond_error(req, handler, error);
+  unique_ptr<Tokenizer> tokenizer(get_tokenizer(req, model, error)); if (!tokenizer) return respond_error(req, handler, error);
+  rest_output_mode output(XML); if (!get_output_mode(req, output, error)) return respond_error(req, handler, error);
 
   class generator : public rest_response_generator {
    public:
-    generator(const model_info* model, string&& data, const Ner* ner, Tokenizer* tokenizer, rest_output_mode output)
-        : rest_response_generator(model, output), data(data), ner(ner), tokenizer(tokenizer), unprinted(this->data.c_str()) {
+    generator(const model_info* model, string&& data, nametag_batcher* batcher, Tokenizer* tokenizer, rest_output_mode output, deadline_t deadline, nametag_metrics* metrics)
+        : rest_response_generator(model, output, deadline, metrics), data(data), batcher(batcher), tokenizer(tokenizer), unprinted(this->data.c_str()) {
       tokenizer->set_text(this->data);
     }
 
@@ -163,15 +199,39 @@ bool nametag_service::handle_rest_recognize(microrestd::rest_request& req) {
     }
 
     bool next(bool /*first*/) {
-      if (!tokenizer->next_sentence(&forms, nullptr)) {
+      nametag_metrics::timer timer(metrics);
+      if (!tokenizer->next_sentence(&forms, output.mode == ENTITIES && !output.byte_offsets ? &tokens : nullptr)) {
         if (output.mode == XML && *unprinted) json.value_xml_escape(unprinted, true);
+        if (output.mode == ENTITIES && output.token_offsets) {
+          // Entities were buffered, because the token offsets came first
+          json.close().key("entities").array();
+          for (auto&& entity : document_entities)
+            json.array().value(int(entity.start)).value(int(entity.length)).value(entity.type).close();
+        }
         return false;
       }
+      timer.finished(nametag_metrics::TOKENIZATION);
+
+      recognition_observer::current() = metrics;
+      batcher->recognize(forms, entities);
+      recognition_observer::current() = nullptr;
+      timer.restart();
 
-      ner->recognize(forms, entities);
       sort_entities(entities);
 
-      if (output.mode == CONLL) {
+      if (output.mode == ENTITIES) {
+        // Entities and optionally tokens as [start, length(, type)] triples
+        for (auto&& entity : entities) {
+          size_t start = offset_start(entity.start), length = offset_end(entity.start + entity.length - 1) - start;
+          if (output.token_offsets)
+            document_entities.emplace_back(start, length, entity.type);
+          else
+            json.array().value(int(start)).value(int(length)).value(entity.type).close();
+        }
+        if (output.token_offsets)
+          for (unsigned i = 0; i < forms.size(); i++)
+            json.array().value(int(offset_start(i))).value(int(offset_end(i) - offset_start(i))).close();
+      } else if (output.mode == CONLL) {
         vector<named_entity> stack;
         for (size_t i = 0, e = 0; i < forms.size(); i++) {
           for (; e < entities.size() && entities[e].start == i; e++)
@@ -234,46 +294,63 @@ bool nametag_service::handle_rest_recognize(microrestd::rest_request& req) {
       }
 
       total_tokens += forms.size() + 1;
+      timer.finished(nametag_metrics::RESPONSE);
       return true;
     }
 
    private:
+    // Offsets of the i-th token of the current sentence
+    size_t offset_start(size_t i) const {
+      return output.byte_offsets ? forms[i].str - data.c_str() : tokens[i].start;
+    }
+    size_t offset_end(size_t i) const {
+      return output.byte_offsets ? forms[i].str + forms[i].len - data.c_str() : tokens[i].start + tokens[i].length;
+    }
+
     string data;
-    const Ner* ner;
+    nametag_batcher* batcher;
     unique_ptr<Tokenizer> tokenizer;
     const char* unprinted;
     vector<string_piece> forms;
-    vector<named_entity> entities;
+    vector<token_range> tokens;
+    vector<named_entity> entities, document_entities;
     vector<size_t> entity_ends;
     size_t total_tokens = 0;
     char token_number[sizeof(size_t) * 3/*ceil(log_10(256))*/];
   };
-  return req.respond(json_mime, new generator(model, std::move(data), model->ner.get(), tokenizer.release(), output), {{infclen_header, to_string(infclen).c_str()}});
+  return req.respond(json_mime, new generator(model, std::move(data), model->batcher.get(), tokenizer.release(), output, deadline, &metrics), {{infclen_header, to_string(infclen).c_str()}});
 }
 
 bool nametag_service::handle_rest_tokenize(microrestd::rest_request& req) {
+  const auto handler = nametag_metrics::TOKENIZE;
+  metrics.request(handler);
+
   string error;
   auto rest_id = get_rest_model_id(req);
   auto model = load_rest_model(rest_id, error);
-  if (!model) return req.respond_error(error);
-  if (!model->can_tokenize) return req.respond_error(operation_not_supported);
+  if (!model) return respond_error(req, handler, error);
+  if (!model->can_tokenize) return respond_error(req, handler, operation_not_supported);
 
-  string data; int infclen; if (!get_data(req, data, infclen, error)) return req.respond_error(error);
-  rest_output_mode output(XML); if (!get_output_mode(req, output, error)) return req.respond_error(error);
-  if (output.mode == CONLL) return req.respond_error("Unsupported output mode 'conll'");
+  rest_response_generator::deadline_t deadline; if (!get_deadline(req, deadline, error)) return respond_error(req, handler, error);
+  string data; int infclen; if (!get_data(req, handler, data, infclen, error)) return respond_error(req, handler, error);
+  rest_output_mode output(XML); if (!get_output_mode(req, output, error)) return respond_error(req, handler, error);
+  if (output.mode == CONLL) return respond_error(req, handler, "Unsupported output mode 'conll'");
+  if (output.mode == ENTITIES) return respond_error(req, handler, "Unsupported output mode 'entities'");
 
   class generator : public rest_response_generator {
    public:
-    generator(const model_info* model, string&& data, rest_output_mode output, Tokenizer* tokenizer)
-        : rest_response_generator(model, output), data(data), tokenizer(tokenizer), unprinted(this->data.c_str()) {
+    generator(const model_info* model, string&& data, rest_output_mode output, Tokenizer* tokenizer, deadline_t deadline, nametag_metrics* metrics)
+        : rest_response_generator(model, output, deadline, metrics), data(data), tokenizer(tokenizer), unprinted(this->data.c_str()) {
       tokenizer->set_text(this->data);
     }
 
     bool next(bool /*first*/) {
+      nametag_metrics::timer timer(metrics);
       if (!tokenizer->next_sentence(&forms, nullptr)) {
         if (output.mode == XML && *unprinted) json.value_xml_escape(unprinted, true);
         return false;
       }
+      timer.finished(nametag_metrics::TOKENIZATION);
 
       for (unsigned i = 0; i < forms.size(); i++) {
         switch (output.mode) {
@@ -286,6 +363,7 @@ bool nametag_service::handle_rest_tokenize(microrestd::rest_request& req) {
             json.value("<token>", true).value_xml_escape(sp(forms[i]), true).value("</token>", true);
             break;
           case CONLL: // Keep the compiler happy
+          case ENTITIES:
             break;
         }
         unprinted = forms[i].str + forms[i].len;
@@ -293,6 +371,7 @@ bool nametag_service::handle_rest_tokenize(microrestd::rest_request& req) {
       if (output.mode == VERTICAL) json.value("\n", true);
       if (output.mode == XML) json.value("</sentence>", true);
 
+      timer.finished(nametag_metrics::RESPONSE);
       return true;
     }
 
@@ -302,11 +381,24 @@ bool nametag_service::handle_rest_tokenize(microrestd::rest_request& req) {
     const char* unprinted;
     vector<string_piece> forms;
   };
-  return req.respond(json_mime, new generator(model, std::move(data), output, model->ner->new_tokenizer()), {{infclen_header, to_string(infclen).c_str()}});
+  return req.respond(json_mime, new generator(model, std::move(data), output, model->ner->new_tokenizer(), deadline, &metrics), {{infclen_header, to_string(infclen).c_str()}});
+}
+
+bool nametag_service::handle_metrics(microrestd::rest_request& req) {
+  metrics.request(nametag_metrics::METRICS);
+
+  string output;
+  metrics.write(output);
+  return req.respond(metrics_mime, output);
 }
 
 // REST service helpers
 
+bool nametag_service::respond_error(microrestd::rest_request& req, nametag_metrics::handler_t handler, microrestd::string_piece error) {
+  metrics.request_error(handler);
+  return req.respond_error(error);
+}
+
 const string& nametag_service::get_rest_model_id(microrestd::rest_request& req) {
   static string empty;
 
@@ -314,10 +406,12 @@ const string& nametag_service::get_rest_model_id(microrestd::rest_request& req)
   return model_it == req.params.end() ? empty : model_it->second;
 }
 
-bool nametag_service::get_data(microrestd::rest_request& req, string& data, int& infclen, string& error) {
+bool nametag_service::get_data(microrestd::rest_request& req, nametag_metrics::handler_t handler, string& data, int& infclen, string& error) {
   auto data_it = req.params.find("data");
   if (data_it == req.params.end()) return error.assign("Required argument 'data' is missing.\n"), false;
+  metrics.request_body(handler, data_it->second.size());
 
+  nametag_metrics::timer timer(&metrics);
   u32string codepoints;
   unilib::utf8::decode(data_it->second, codepoints);
   unilib::uninorms::nfc(codepoints);
@@ -325,6 +419,7 @@ bool nametag_service::get_data(microrestd::rest_request& req, string& data, int&
   for (auto&& codepoint : codepoints)
     infclen += !(unilib::unicode::category(codepoint) & (unilib::unicode::C | unilib::unicode::Z));
   unilib::utf8::encode(codepoints, data);
+  timer.finished(nametag_metrics::NORMALIZATION);
   return true;
 }
 
@@ -342,6 +437,31 @@ bool nametag_service::get_output_mode(microrestd::rest_request& req, rest_output
   auto output_it = req.params.find("output");
   if (output_it != req.params.end() && !rest_output_mode::parse(output_it->second, output))
     return error.assign("Unknown output mode '").append(output_it->second).append("'.\n"), false;
+
+  if (output.mode == ENTITIES) {
+    auto offsets_it = req.params.find("offsets");
+    if (offsets_it != req.params.end()) {
+      if (offsets_it->second.compare("bytes") == 0) output.byte_offsets = true;
+      else if (offsets_it->second.compare("chars") != 0)
+        return error.assign("Value '").append(offsets_it->second).append("' of parameter offsets is not either 'chars' or 'bytes'.\n"), false;
+    }
+    output.token_offsets = req.params.count("tokens");
+  }
+  return true;
+}
+
+bool nametag_service::get_deadline(microrestd::rest_request& req, rest_response_generator::deadline_t& deadline, string& error) {
+  int milliseconds = options.max_deadline;
+
+  auto deadline_it = req.params.find("deadline");
+  if (deadline_it != req.params.end()) {
+    int requested;
+    if (!utils::parse_int(deadline_it->second, "deadline", requested, error)) return error.append("\n"), false;
+    if (requested <= 0) return error.assign("The deadline must be a positive number of milliseconds.\n"), false;
+    if (!milliseconds || requested < milliseconds) milliseconds = requested;
+  }
+
+  deadline = milliseconds ? chrono::steady_clock::now() + chrono::milliseconds(milliseconds) : rest_response_generator::deadline_t::max();
   return true;
 }
 
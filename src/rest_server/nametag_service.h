@@ -9,10 +9,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <unordered_map>
 
 #include "common.h"
 #include "microrestd/microrestd.h"
+#include "nametag_batcher.h"
+#include "nametag_metrics.h"
 #include "ner/ner.h"
 #include "tokenizer/tokenizer.h"
 
@@ -33,7 +36,22 @@ class nametag_service : public microrestd::rest_service {
         : rest_id(rest_id), file(file), acknowledgements(acknowledgements) {}
   };
 
-  bool init(const vector<model_description>& model_descriptions);
+  struct service_options {
+    // When batch_size is greater than one, sentences of concurrent requests for
+    // the same model are recognized in batches of at most batch_size sentences,
+    // waiting at most batch_wait microseconds for a batch to fill.
+    unsigned batch_size, batch_wait;
+    // Maximum processing time of a request in milliseconds, 0 means unlimited.
+    unsigned max_deadline;
+    // When not nullptr, the processing stages are recorded in the trace.
+    recognition_trace* trace;
+    // When not nullptr, the statistics of the server are included in the metrics.
+    const microrestd::rest_server* server;
+
+    service_options() : batch_size(1), batch_wait(0), max_deadline(0), trace(nullptr), server(nullptr) {}
+  };
+
+  bool init(const vector<model_description>& model_descriptions, const service_options& options = service_options());
 
   virtual bool handle(microrestd::rest_request& req) override;
 
@@ -50,6 +68,7 @@ class nametag_service : public microrestd::rest_service {
 
     string rest_id;
     unique_ptr<Ner> ner;
+    unique_ptr<nametag_batcher> batcher;
     bool can_tokenize;
     string acknowledgements;
   };
@@ -63,37 +82,53 @@ class nametag_service : public microrestd::rest_service {
     XML,
     VERTICAL,
     CONLL,
+    ENTITIES,
   };
   struct rest_output_mode {
     rest_output_mode_t mode;
+    bool byte_offsets, token_offsets;
 
-    rest_output_mode(rest_output_mode_t mode) : mode(mode) {}
+    rest_output_mode(rest_output_mode_t mode) : mode(mode), byte_offsets(false), token_offsets(false) {}
     static bool parse(const string& mode, rest_output_mode& output);
   };
 
   class rest_response_generator : public microrestd::json_response_generator {
    public:
-    rest_response_generator(const model_info* model, rest_output_mode output);
+    typedef chrono::steady_clock::time_point deadline_t;
+
+    rest_response_generator(const model_info* model, rest_output_mode output, deadline_t deadline, nametag_metrics* metrics);
+    virtual ~rest_response_generator() override;
 
     virtual bool next(bool first) = 0;
     virtual bool generate() override;
+    virtual bool cancelled() const override;
+    virtual void abandoned() override;
 
    protected:
-    bool first, last;
+    bool first, last, deadline_exceeded;
     rest_output_mode output;
+    deadline_t deadline;
+    nametag_metrics* metrics;
   };
 
   bool handle_rest_models(microrestd::rest_request& req);
   bool handle_rest_recognize(microrestd::rest_request& req);
   bool handle_rest_tokenize(microrestd::rest_request& req);
+  bool handle_metrics(microrestd::rest_request& req);
+
+  bool respond_error(microrestd::rest_request& req, nametag_metrics::handler_t handler, microrestd::string_piece error);
 
   const string& get_rest_model_id(microrestd::rest_request& req);
-  bool get_data(microrestd::rest_request& req, string& data, int& infclen, string& error);
+  bool get_data(microrestd::rest_request& req, nametag_metrics::handler_t handler, string& data, int& infclen, string& error);
   tokenizer* get_tokenizer(microrestd::rest_request& req, const model_info* model, string& error);
   bool get_output_mode(microrestd::rest_request& req, rest_output_mode& mode, string& error);
+  bool get_deadline(microrestd::rest_request& req, rest_response_generator::deadline_t& deadline, string& error);
 
   microrestd::json_builder json_models;
+  service_options options;
+  nametag_metrics metrics;
   static const char* json_mime;
+  static const char* metrics_mime;
   static const char* operation_not_supported;
   static const char* infclen_header;
 };
@@ -10,7 +10,9 @@
 #include <algorithm>
 #include <ctime>
 
+#include "ner/allocation_counter.h"
 #include "ner/ner.h"
+#include "ner/recognition_trace.h"
 #include "utils/getpara.h"
 #include "utils/iostreams.h"
 #include "utils/options.h"
@@ -20,28 +22,66 @@
 
 using namespace ufal::nametag;
 
+// Consecutive stages of the processing, recorded in the trace and with their
+// allocations counted, when requested.
+class pipeline_stages {
+ public:
+  enum stage_t { READING, TOKENIZATION, RECOGNITION, OUTPUT, STAGES_TOTAL };
+
+  pipeline_stages(recognition_trace* trace, bool count_allocations)
+      : sentences(0), allocations(), timer(trace), count_allocations(count_allocations), last(allocation_counter::current()) {}
+
+  inline void finished(stage_t stage) {
+    static const char* names[STAGES_TOTAL] = {"reading", "tokenization", "recognition", "output"};
+
+    if (stage == RECOGNITION) sentences++;
+    if (count_allocations) {
+      auto& current = allocation_counter::current();
+      allocations[stage].allocations += current.allocations - last.allocations;
+      allocations[stage].bytes += current.bytes - last.bytes;
+    }
+    timer.finished(names[stage], "pipeline");
+    if (count_allocations) last = allocation_counter::current();
+  }
+
+  uint64_t sentences;
+  allocation_counter::counts allocations[STAGES_TOTAL];
+
+ private:
+  recognition_trace::timer timer;
+  bool count_allocations;
+  allocation_counter::counts last;
+};
+
+static void report_allocations(const char* name, allocation_counter::counts counts, uint64_t sentences);
 static void sort_entities(vector<named_entity>& entities);
-static void recognize_conll(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer);
-static void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer);
-static void recognize_untokenized(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer);
+static void recognize_conll(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages);
+static void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages);
+static void recognize_untokenized(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages);
 
 int main(int argc, char* argv[]) {
   iostreams_init();
 
   options::map options;
   if (!options::parse({{"input",options::value{"untokenized", "vertical"}},
+                       {"allocations",options::value::none},
                        {"output",options::value{"vertical","xml", "conll"}},
+                       {"trace",options::value::any},
                        {"version", options::value::none},
                        {"help", options::value::none}}, argc, argv, options) ||
       options.count("help") ||
       (argc < 2 && !options.count("version")))
     runtime_failure("Usage: " << argv[0] << " [options] recognizer_model [file[:output_file]]...\n"
-                    "Options: --input=untokenized|vertical\n"
+                    "Options: --allocations (report heap allocations per sentence, run_ner_alloc only)\n"
+                    "         --input=untokenized|vertical\n"
                     "         --output=conll|vertical|xml\n"
+                    "         --trace=file for Chrome trace events of the processing\n"
                     "         --version\n"
                     "         --help");
   if (options.count("version"))
     return cout << version::version_and_copyright() << endl, 0;
+  if (options.count("allocations") && !allocation_counter::installed())
+    runtime_failure("The --allocations option requires the run_ner_alloc binary, which counts heap allocations!");
 
   cerr << "Loading ner: ";
   unique_ptr<ner> recognizer(ner::load(argv[1]));
@@ -51,25 +91,60 @@ int main(int argc, char* argv[]) {
   unique_ptr<tokenizer> tokenizer(options.count("input") && options["input"] == "vertical" ? tokenizer::new_vertical_tokenizer() : recognizer->new_tokenizer());
   if (!tokenizer) runtime_failure("No tokenizer is defined for the supplied model!");
 
+  recognition_trace trace;
+  if (options.count("trace") && !trace.open(options["trace"], "run_ner"))
+    runtime_failure("Cannot open trace file '" << options["trace"] << "' for writing!");
+  recognition_trace* tracing = trace.is_open() ? &trace : nullptr;
+
+  bool count_allocations = options.count("allocations");
+  recognition_allocations allocations(tracing);
+  recognition_observer::current() = count_allocations ? &allocations : (recognition_observer*) tracing;
+
+  pipeline_stages stages(tracing, count_allocations);
   clock_t now = clock();
-  if (options.count("output") && options["output"] == "vertical")  process_args(2, argc, argv, recognize_vertical, *recognizer, *tokenizer);
-  else if (options.count("output") && options["output"] == "conll")  process_args(2, argc, argv, recognize_conll, *recognizer, *tokenizer);
-  else process_args(2, argc, argv, recognize_untokenized, *recognizer, *tokenizer);
+  if (options.count("output") && options["output"] == "vertical")  process_args(2, argc, argv, recognize_vertical, *recognizer, *tokenizer, stages);
+  else if (options.count("output") && options["output"] == "conll")  process_args(2, argc, argv, recognize_conll, *recognizer, *tokenizer, stages);
+  else process_args(2, argc, argv, recognize_untokenized, *recognizer, *tokenizer, stages);
   cerr << "Recognizing done, in " << fixed << setprecision(3) << (clock() - now) / double(CLOCKS_PER_SEC) << " seconds." << endl;
+  recognition_observer::current() = nullptr;
+
+  if (count_allocations) {
+    static const char* stage_names[] = {"tagging", "features", "classification", "decoding", "entities"};
+
+    cerr << "Heap allocations per sentence (count, bytes):" << endl;
+    report_allocations("reading", stages.allocations[pipeline_stages::READING], stages.sentences);
+    report_allocations("tokenization", stages.allocations[pipeline_stages::TOKENIZATION], stages.sentences);
+    report_allocations("recognition", stages.allocations[pipeline_stages::RECOGNITION], stages.sentences);
+    for (int stage = 0; stage < recognition_observer::STAGES_TOTAL; stage++)
+      for (unsigned network = 0; network < recognition_allocations::NETWORKS_MAX; network++)
+        if (allocations.calls(recognition_observer::stage_t(stage), network)) {
+          bool per_network = stage == recognition_observer::FEATURES || stage == recognition_observer::CLASSIFICATION || stage == recognition_observer::DECODING;
+          report_allocations((string("  ") + stage_names[stage] + (per_network ? " " + to_string(network + 1) : string())).c_str(),
+                             allocations.stage(recognition_observer::stage_t(stage), network), stages.sentences);
+        }
+    report_allocations("output", stages.allocations[pipeline_stages::OUTPUT], stages.sentences);
+  }
+
+  if (tracing && !trace.close())
+    runtime_failure("Cannot write trace file '" << options["trace"] << "'!");
 
   return 0;
 }
 
-void recognize_conll(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer) {
+void recognize_conll(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages) {
   string para;
   vector<string_piece> forms;
   vector<named_entity> entities;
 
   while (getpara(is, para)) {
+    stages.finished(pipeline_stages::READING);
+
     // Tokenize and tag
     tokenizer.set_text(para);
     while (tokenizer.next_sentence(&forms, nullptr)) {
+      stages.finished(pipeline_stages::TOKENIZATION);
       recognizer.recognize(forms, entities);
+      stages.finished(pipeline_stages::RECOGNITION);
       sort_entities(entities);
 
       vector<named_entity> stack;
@@ -92,11 +167,12 @@ void recognize_conll(istream& is, ostream& os, const ner& recognizer, tokenizer&
       }
 
       os << '\n' << flush;
+      stages.finished(pipeline_stages::OUTPUT);
     }
   }
 }
 
-void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer) {
+void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages) {
   string para;
   vector<string_piece> forms;
   vector<named_entity> entities;
@@ -104,10 +180,14 @@ void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokeniz
   string entity_ids, entity_text;
 
   while (getpara(is, para)) {
+    stages.finished(pipeline_stages::READING);
+
     // Tokenize and tag
     tokenizer.set_text(para);
     while (tokenizer.next_sentence(&forms, nullptr)) {
+      stages.finished(pipeline_stages::TOKENIZATION);
       recognizer.recognize(forms, entities);
+      stages.finished(pipeline_stages::RECOGNITION);
       sort_entities(entities);
 
       for (auto&& entity : entities) {
@@ -125,22 +205,27 @@ void recognize_vertical(istream& is, ostream& os, const ner& recognizer, tokeniz
       }
       os << flush;
       total_tokens += forms.size() + 1;
+      stages.finished(pipeline_stages::OUTPUT);
     }
   }
 }
 
-void recognize_untokenized(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer) {
+void recognize_untokenized(istream& is, ostream& os, const ner& recognizer, tokenizer& tokenizer, pipeline_stages& stages) {
   string para;
   vector<string_piece> forms;
   vector<named_entity> entities;
   vector<size_t> entity_ends;
 
   while (getpara(is, para)) {
+    stages.finished(pipeline_stages::READING);
+
     // Tokenize the text and find named entities
     tokenizer.set_text(para);
     const char* unprinted = para.c_str();
     while (tokenizer.next_sentence(&forms, nullptr)) {
+      stages.finished(pipeline_stages::TOKENIZATION);
       recognizer.recognize(forms, entities);
+      stages.finished(pipeline_stages::RECOGNITION);
       sort_entities(entities);
 
       for (unsigned i = 0, e = 0; i < forms.size(); i++) {
@@ -164,13 +249,20 @@ void recognize_untokenized(istream& is, ostream& os, const ner& recognizer, toke
         if (i + 1 == forms.size()) os << "</sentence>";
         unprinted = forms[i].str + forms[i].len;
       }
+      stages.finished(pipeline_stages::OUTPUT);
     }
     // Write rest of the text (should be just spaces)
     if (unprinted < para.c_str() + para.size()) os << xml_encoded(string_piece(unprinted, para.c_str() + para.size() - unprinted));
     os << flush;
+    stages.finished(pipeline_stages::OUTPUT);
   }
 }
 
+void report_allocations(const char* name, allocation_counter::counts counts, uint64_t sentences) {
+  cerr << "  " << name << ": " << fixed << setprecision(2) << counts.allocations / double(sentences ? sentences : 1)
+       << ", " << setprecision(0) << counts.bytes / double(sentences ? sentences : 1) << endl;
+}
+
 void sort_entities(vector<named_entity>& entities) {
   struct named_entity_comparator {
     static bool lt(const named_entity& a, const named_entity& b) {
@@ -77,5 +77,12 @@ void morphodita_tagger::tag(const vector<string_piece>& forms, ner_sentence& sen
   caches.push(c);
 }
 
+void morphodita_tagger::memory_footprint(vector<memory_component>& components) const {
+  vector<pair<string, size_t>> tagger_components;
+  tagger->memory_footprint(tagger_components);
+  for (auto&& component : tagger_components)
+    components.emplace_back("tagger " + component.first, component.second);
+}
+
 } // namespace nametag
 } // namespace ufal
@@ -12,7 +12,7 @@
 #include "common.h"
 #include "morphodita/tagger/tagger.h"
 #include "tagger.h"
-#include "utils/threadsafe_stack.h"
+#include "utils/cache_pool.h"
 
 
 namespace ufal {
@@ -21,6 +21,7 @@ namespace nametag {
 class morphodita_tagger : public tagger {
  public:
   virtual void tag(const vector<string_piece>& forms, ner_sentence& sentence) const override;
+  virtual void memory_footprint(vector<memory_component>& components) const override;
 
  protected:
   virtual bool load(istream& is) override;
@@ -34,7 +35,7 @@ class morphodita_tagger : public tagger {
     vector<morphodita::tagged_lemma> tags, analyses;
     string lemma_cased;
   };
-  mutable threadsafe_stack<cache> caches;
+  mutable cache_pool<cache> caches;
 };
 
 } // namespace nametag
@@ -16,6 +16,8 @@
 namespace ufal {
 namespace nametag {
 
+void tagger::memory_footprint(vector<memory_component>& /*components*/) const {}
+
 tagger* tagger::load_instance(istream& is) {
   unique_ptr<tagger> res(create(tagger_id(is.get())));
 
@@ -11,6 +11,7 @@
 
 #include "common.h"
 #include "bilou/ner_sentence.h"
+#include "ner/ner.h"
 #include "tagger_ids.h"
 #include "utils/string_piece.h"
 
@@ -23,6 +24,9 @@ class tagger {
 
   virtual void tag(const vector<string_piece>& forms, ner_sentence& sentence) const = 0;
 
+  // Append the memory allocated by the tagger components.
+  virtual void memory_footprint(vector<memory_component>& components) const;
+
   // Factory methods
   static tagger* load_instance(istream& is);
   static tagger* create_and_encode_instance(const string& tagger_id_and_params, ostream& os);
@@ -8,6 +8,7 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <fstream>
+#include <sstream>
 
 #include "ner/bilou_ner_trainer.h"
 #include "ner/ner_ids.h"
@@ -17,6 +18,7 @@
 #include "utils/parse_double.h"
 #include "utils/parse_int.h"
 #include "utils/path_from_utf8.h"
+#include "utils/split.h"
 #include "version/version.h"
 
 using namespace ufal::nametag;
@@ -24,19 +26,54 @@ using namespace ufal::nametag;
 int main(int argc, char* argv[]) {
   iostreams_init();
 
-  ner_id id;
+  // Parse options preceding the ner_identifier -- the identifier specific
+  // options can start with a minus sign (i.e., negative missing_weight).
+  // The option values can be given both as --option=value and --option value.
+  unordered_map<string, options::value> allowed = {{"threads", options::value::any},
+                                                   {"spill_dir", options::value::any},
+                                                   {"tagged_cache", options::value::any},
+                                                   {"sweep", options::value::none},
+                                                   {"early_stopping", options::value::any},
+                                                   {"version", options::value::none},
+                                                   {"help", options::value::none}};
+  int options_argc = 1;
+  while (options_argc < argc && argv[options_argc][0] == '-' && argv[options_argc][1] == '-') {
+    auto option = allowed.find(argv[options_argc] + 2);
+    options_argc++;
+    if (option != allowed.end() && option->second.allowed != options::value::NONE && options_argc < argc) options_argc++;
+  }
+  int ner_argc = argc - options_argc;
+  char** ner_argv = argv + options_argc;
+
   options::map options;
-  if (argc == 1 || !ner_ids::parse(argv[1], id))
-    if (!options::parse({{"version", options::value::none},
-                         {"help", options::value::none}}, argc, argv, options) ||
-        options.count("help") ||
-        (argc < 2 && !options.count("version")))
-      runtime_failure("Usage: " << argv[0] << " [options] ner_identifier [ner_identifier_specific_options]\n"
-                      "Options: --version\n"
-                      "         --help");
+  if (!options::parse(allowed, options_argc, argv, options) ||
+      options.count("help") ||
+      (!ner_argc && !options.count("version")))
+    runtime_failure("Usage: " << argv[0] << " [options] ner_identifier [ner_identifier_specific_options]\n"
+                    "Options: --threads=number of training threads (default 1)\n"
+                    "         --spill_dir=directory for temporary training instances files\n"
+                    "         --tagged_cache=directory with cached tagged data\n"
+                    "         --sweep (allow comma-separated lists of network parameters)\n"
+                    "         --early_stopping=iterations without heldout improvement before stopping\n"
+                    "         --version\n"
+                    "         --help");
   if (options.count("version"))
     return cout << version::version_and_copyright() << endl, 0;
 
+  for (int i = 0; i < ner_argc; i++)
+    argv[options_argc + i] = ner_argv[i];
+  argc = options_argc + ner_argc;
+
+  bilou_ner_trainer::training_options training_options;
+  int threads = options.count("threads") ? parse_int(options["threads"], "number of threads") : 1;
+  if (threads < 1) runtime_failure("The number of threads must be positive!");
+  training_options.threads = threads;
+  training_options.spill_dir = options["spill_dir"];
+  training_options.tagged_cache_dir = options["tagged_cache"];
+  int early_stopping = options.count("early_stopping") ? parse_int(options["early_stopping"], "early stopping iterations") : 0;
+  if (early_stopping < 0) runtime_failure("The early stopping iterations must not be negative!");
+
+  ner_id id;
   if (!ner_ids::parse(argv[1], id)) runtime_failure("Cannot parse ner_identifier '" << argv[1] << "'!\n");
 
   // Switch stdout to binary mode.
@@ -52,20 +89,49 @@ int main(int argc, char* argv[]) {
         // Encode the ner_id
         cout.put(id);
 
-        // Create and encode the tagger
-        unique_ptr<tagger> tagger(tagger::create_and_encode_instance(argv[2], cout));
+        // Create and encode the tagger. When caching tagged data, the encoded
+        // tagger is also used to identify it.
+        unique_ptr<tagger> tagger;
+        if (training_options.tagged_cache_dir.empty()) {
+          tagger.reset(tagger::create_and_encode_instance(argv[2], cout));
+        } else {
+          ostringstream encoded_tagger;
+          tagger.reset(tagger::create_and_encode_instance(argv[2], encoded_tagger));
+          training_options.tagger_key = encoded_tagger.str();
+          cout << training_options.tagger_key;
+        }
         if (!tagger) runtime_failure("Cannot load and encode tagger!");
 
-        // Parse options
-        network_parameters parameters;
+        // Parse options. With --sweep, the network parameters can be
+        // comma-separated lists, and all their combinations are tried.
         const char* features_file = argv[3];
         int stages = parse_int(argv[4], "stages");
-        parameters.iterations = parse_int(argv[5], "iterations");
-        parameters.missing_weight = parse_double(argv[6], "missing_weight");
-        parameters.initial_learning_rate = parse_double(argv[7], "initial_learning_rate");
-        parameters.final_learning_rate = parse_double(argv[8], "final_learning_rate");
-        parameters.gaussian_sigma = parse_double(argv[9], "gaussian");
-        parameters.hidden_layer = parse_int(argv[10], "hidden_layer");
+        vector<network_parameters> parameters(1);
+        vector<string_piece> values;
+        for (int i = 5; i <= 10; i++) {
+          if (options.count("sweep"))
+            split(argv[i], ',', values);
+          else
+            values.assign(1, argv[i]);
+
+          vector<network_parameters> combinations;
+          for (auto&& combination : parameters)
+            for (auto&& value : values) {
+              combinations.push_back(combination);
+              auto& current = combinations.back();
+              switch (i) {
+                case 5: current.iterations = parse_int(value, "iterations"); break;
+                case 6: current.missing_weight = parse_double(value, "missing_weight"); break;
+                case 7: current.initial_learning_rate = parse_double(value, "initial_learning_rate"); break;
+                case 8: current.final_learning_rate = parse_double(value, "final_learning_rate"); break;
+                case 9: current.gaussian_sigma = parse_double(value, "gaussian"); break;
+                case 10: current.hidden_layer = parse_int(value, "hidden_layer"); break;
+              }
+            }
+          parameters.swap(combinations);
+        }
+        for (auto&& current : parameters)
+          current.early_stopping = early_stopping;
         const char* heldout_file = argc == 11 ? nullptr : argv[11];
 
         // Open needed files
@@ -81,7 +147,7 @@ int main(int argc, char* argv[]) {
         }
 
         // Encode the ner itself
-        bilou_ner_trainer::train(id, stages, parameters, *tagger, features, cin, heldout, cout);
+        bilou_ner_trainer::train(id, stages, parameters, *tagger, features, cin, heldout, cout, training_options);
 
         cerr << "Recognizer saved." << endl;
         break;
@@ -0,0 +1,323 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "common.h"
+
+namespace ufal {
+namespace nametag {
+namespace utils {
+
+//
+// Declarations
+//
+
+// Statistics of cache pools.
+struct cache_pool_statistics {
+  size_t stored = 0;    // Number of objects currently stored
+  size_t hits = 0;      // Number of pops served from the slot of the thread
+  size_t steals = 0;    // Number of pops served from a slot of another thread
+  size_t misses = 0;    // Number of pops which found the pool empty
+  size_t trimmed = 0;   // Number of objects deleted by the trim policy
+};
+
+// Base of all cache pools, which keeps the process-wide trim policy and
+// allows gathering statistics of all the pools.
+class cache_pool_base {
+ public:
+  virtual ~cache_pool_base();
+
+  // Keep at most max_objects objects in every pool (zero means unlimited)
+  // and delete the objects unused for more than max_idle seconds (zero means
+  // never). The policy is applied when objects are returned to the pools,
+  // at most once a second for every pool, and during trim_all.
+  static inline void set_trim_policy(size_t max_objects, double max_idle);
+  static inline void trim_all();
+  static inline void statistics_all(cache_pool_statistics& statistics);
+
+  // Apply the trim policy to this pool, or add its statistics.
+  virtual void trim() = 0;
+  virtual void statistics(cache_pool_statistics& statistics) const = 0;
+
+ protected:
+  inline cache_pool_base();
+  // Remove the pool from the registry, must be called by derived destructors
+  inline void unregister_pool();
+
+  struct trim_policy {
+    atomic<bool> active;
+    atomic<size_t> max_objects;
+    atomic<chrono::steady_clock::rep> max_idle, interval;
+  };
+  static inline trim_policy& policy();
+  static inline chrono::steady_clock::rep now() { return chrono::steady_clock::now().time_since_epoch().count(); }
+
+  // Index assigned to the current thread, used to choose its slot
+  static inline unsigned thread_index();
+  // Number of slots in every chunk, a power of two
+  static inline unsigned slots_count();
+
+ private:
+  struct registry {
+    mutex pools_mutex;
+    vector<cache_pool_base*> pools;
+  };
+  static inline registry& pools();
+};
+
+// Pool of cached objects, which are popped by a thread, used and pushed back.
+// Every thread prefers its own slot, falling back to the slots of other threads.
+// When all slots are full, another chunk of slots is appended, so the number of
+// stored objects is bounded only by the trim policy; all operations are lock-free.
+// The chunks are released only when the pool is destroyed.
+template <class T>
+class cache_pool : public cache_pool_base {
+ public:
+  inline cache_pool();
+  cache_pool(const cache_pool&) = delete;
+  cache_pool& operator=(const cache_pool&) = delete;
+  virtual ~cache_pool() override;
+
+  // Pop an object, returning nullptr if the pool is empty.
+  inline T* pop();
+  // Push an object to the pool, which takes its ownership.
+  inline void push(T* t);
+
+  virtual void trim() override;
+  virtual void statistics(cache_pool_statistics& statistics) const override;
+
+ private:
+  // Every slot occupies a separate cache line
+  struct slot {
+    atomic<T*> object;
+    atomic<chrono::steady_clock::rep> used;
+    atomic<size_t> hits, steals, misses;
+    char padding[64];
+  };
+  struct chunk {
+    unique_ptr<slot[]> slots;
+    atomic<chunk*> next;
+
+    inline chunk(unsigned slots_count);
+  };
+  chunk first;
+  unsigned slots_mask;
+  atomic<chrono::steady_clock::rep> next_trim;
+  atomic<size_t> trimmed;
+
+  inline void pushed(slot& s);
+};
+
+//
+// Definitions
+//
+
+inline cache_pool_base::cache_pool_base() {
+  auto& registry = pools();
+  lock_guard<mutex> lock(registry.pools_mutex);
+  registry.pools.push_back(this);
+}
+
+inline cache_pool_base::~cache_pool_base() {
+  unregister_pool();
+}
+
+inline void cache_pool_base::unregister_pool() {
+  auto& registry = pools();
+  lock_guard<mutex> lock(registry.pools_mutex);
+  auto it = find(registry.pools.begin(), registry.pools.end(), this);
+  if (it != registry.pools.end()) registry.pools.erase(it);
+}
+
+inline void cache_pool_base::set_trim_policy(size_t max_objects, double max_idle) {
+  auto& policy = cache_pool_base::policy();
+  auto max_idle_duration = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(max_idle));
+  auto interval_duration = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(max_idle > 0 && max_idle < 2 ? max_idle / 2 : 1));
+
+  policy.max_objects.store(max_objects, memory_order_relaxed);
+  policy.max_idle.store(max_idle > 0 ? max_idle_duration.count() : 0, memory_order_relaxed);
+  policy.interval.store(interval_duration.count(), memory_order_relaxed);
+  policy.active.store(max_objects || max_idle > 0, memory_order_release);
+}
+
+inline void cache_pool_base::trim_all() {
+  auto& registry = pools();
+  lock_guard<mutex> lock(registry.pools_mutex);
+  for (auto&& pool : registry.pools)
+    pool->trim();
+}
+
+inline void cache_pool_base::statistics_all(cache_pool_statistics& statistics) {
+  statistics = cache_pool_statistics();
+
+  auto& registry = pools();
+  lock_guard<mutex> lock(registry.pools_mutex);
+  for (auto&& pool : registry.pools)
+    pool->statistics(statistics);
+}
+
+inline cache_pool_base::trim_policy& cache_pool_base::policy() {
+  static trim_policy policy;
+  return policy;
+}
+
+inline unsigned cache_pool_base::thread_index() {
+  static atomic<unsigned> threads(0);
+  static thread_local unsigned index = threads.fetch_add(1, memory_order_relaxed);
+  return index;
+}
+
+inline unsigned cache_pool_base::slots_count() {
+  unsigned slots_count = 16;
+  while (slots_count < 2 * thread::hardware_concurrency()) slots_count *= 2;
+  return slots_count;
+}
+
+inline cache_pool_base::registry& cache_pool_base::pools() {
+  static registry pools;
+  return pools;
+}
+
+template <class T>
+cache_pool<T>::chunk::chunk(unsigned slots_count) : slots(new slot[slots_count]), next(nullptr) {
+  for (unsigned i = 0; i < slots_count; i++) {
+    slots[i].object.store(nullptr, memory_order_relaxed);
+    slots[i].used.store(0, memory_order_relaxed);
+    slots[i].hits.store(0, memory_order_relaxed);
+    slots[i].steals.store(0, memory_order_relaxed);
+    slots[i].misses.store(0, memory_order_relaxed);
+  }
+}
+
+template <class T>
+cache_pool<T>::cache_pool() : first(slots_count()), slots_mask(slots_count() - 1), next_trim(0), trimmed(0) {}
+
+template <class T>
+cache_pool<T>::~cache_pool() {
+  unregister_pool();
+  for (chunk* c = &first, *next; c; c = next) {
+    for (unsigned i = 0; i <= slots_mask; i++)
+      delete c->slots[i].object.load(memory_order_acquire);
+    next = c->next.load(memory_order_acquire);
+    if (c != &first) delete c;
+  }
+}
+
+template <class T>
+T* cache_pool<T>::pop() {
+  unsigned index = thread_index();
+  slot& own = first.slots[index & slots_mask];
+
+  T* t = own.object.exchange(nullptr, memory_order_acquire);
+  if (t) return own.hits.fetch_add(1, memory_order_relaxed), t;
+
+  // Try the slots of other threads, including the appended chunks
+  for (chunk* c = &first; c; c = c->next.load(memory_order_acquire))
+    for (unsigned i = c == &first ? 1 : 0; i <= slots_mask; i++) {
+      slot& other = c->slots[(index + i) & slots_mask];
+      if (other.object.load(memory_order_relaxed) && (t = other.object.exchange(nullptr, memory_order_acquire)))
+        return own.steals.fetch_add(1, memory_order_relaxed), t;
+    }
+
+  own.misses.fetch_add(1, memory_order_relaxed);
+  return nullptr;
+}
+
+template <class T>
+void cache_pool<T>::push(T* t) {
+  unsigned index = thread_index();
+  slot& own = first.slots[index & slots_mask];
+
+  T* expected = nullptr;
+  if (own.object.compare_exchange_strong(expected, t, memory_order_release, memory_order_relaxed))
+    return pushed(own);
+
+  // Try the slots of other threads, appending a new chunk when all are full
+  unique_ptr<chunk> appended;
+  for (chunk* c = &first; c; ) {
+    for (unsigned i = c == &first ? 1 : 0; i <= slots_mask; i++) {
+      slot& other = c->slots[(index + i) & slots_mask];
+      expected = nullptr;
+      if (!other.object.load(memory_order_relaxed) &&
+          other.object.compare_exchange_strong(expected, t, memory_order_release, memory_order_relaxed))
+        return pushed(other);
+    }
+
+    chunk* next = c->next.load(memory_order_acquire);
+    if (!next) {
+      if (!appended) appended.reset(new chunk(slots_mask + 1));
+      appended->slots[index & slots_mask].object.store(t, memory_order_relaxed);
+      if (c->next.compare_exchange_strong(next, appended.get(), memory_order_acq_rel, memory_order_acquire))
+        return pushed(appended.release()->slots[index & slots_mask]);
+      // Another thread appended a chunk meanwhile, try its slots
+      appended->slots[index & slots_mask].object.store(nullptr, memory_order_relaxed);
+    }
+    c = next;
+  }
+}
+
+template <class T>
+void cache_pool<T>::pushed(slot& s) {
+  auto& policy = cache_pool_base::policy();
+  if (!policy.active.load(memory_order_acquire)) return;
+
+  // Note the time of the last usage and trim the pool once in a while
+  auto now = cache_pool_base::now();
+  s.used.store(now, memory_order_relaxed);
+
+  auto trim_at = next_trim.load(memory_order_relaxed);
+  if (now >= trim_at && next_trim.compare_exchange_strong(trim_at, now + policy.interval.load(memory_order_relaxed), memory_order_relaxed))
+    trim();
+}
+
+template <class T>
+void cache_pool<T>::trim() {
+  auto& policy = cache_pool_base::policy();
+  if (!policy.active.load(memory_order_acquire)) return;
+
+  size_t max_objects = policy.max_objects.load(memory_order_relaxed), stored = 0;
+  auto max_idle = policy.max_idle.load(memory_order_relaxed);
+  auto now = cache_pool_base::now();
+
+  for (chunk* c = &first; c; c = c->next.load(memory_order_acquire))
+    for (unsigned i = 0; i <= slots_mask; i++) {
+      slot& s = c->slots[i];
+      if (!s.object.load(memory_order_relaxed)) continue;
+
+      if ((max_idle && now - s.used.load(memory_order_relaxed) > max_idle) || (max_objects && stored >= max_objects)) {
+        T* t = s.object.exchange(nullptr, memory_order_acquire);
+        if (t) delete t, trimmed.fetch_add(1, memory_order_relaxed);
+      } else {
+        stored++;
+      }
+    }
+}
+
+template <class T>
+void cache_pool<T>::statistics(cache_pool_statistics& statistics) const {
+  for (const chunk* c = &first; c; c = c->next.load(memory_order_acquire))
+    for (unsigned i = 0; i <= slots_mask; i++) {
+      statistics.stored += c->slots[i].object.load(memory_order_relaxed) ? 1 : 0;
+      statistics.hits += c->slots[i].hits.load(memory_order_relaxed);
+      statistics.steals += c->slots[i].steals.load(memory_order_relaxed);
+      statistics.misses += c->slots[i].misses.load(memory_order_relaxed);
+    }
+  statistics.trimmed += trimmed.load(memory_order_relaxed);
+}
+
+} // namespace utils
+} // namespace nametag
+} // namespace ufal
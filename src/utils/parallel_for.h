@@ -0,0 +1,62 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "common.h"
+
+namespace ufal {
+namespace nametag {
+namespace utils {
+
+//
+// Declarations
+//
+
+// Call body(begin, end) on consecutive chunks of [0, size) of at most chunk
+// elements, using the given number of threads. The chunks are assigned to the
+// threads dynamically; with a single thread, body is called on the current one.
+template <class Body>
+inline void parallel_for(size_t size, size_t chunk, unsigned threads, Body body);
+
+//
+// Definitions
+//
+
+template <class Body>
+void parallel_for(size_t size, size_t chunk, unsigned threads, Body body) {
+  if (!chunk) chunk = 1;
+  if (threads > (size + chunk - 1) / chunk) threads = unsigned((size + chunk - 1) / chunk);
+
+  if (threads <= 1) {
+    for (size_t begin = 0; begin < size; begin += chunk)
+      body(begin, min(begin + chunk, size));
+    return;
+  }
+
+  atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t begin; (begin = next.fetch_add(chunk)) < size; )
+      body(begin, min(begin + chunk, size));
+  };
+
+  vector<thread> workers;
+  for (unsigned i = 1; i < threads; i++)
+    workers.emplace_back(worker);
+  worker();
+  for (auto&& thread : workers)
+    thread.join();
+}
+
+} // namespace utils
+} // namespace nametag
+} // namespace ufal
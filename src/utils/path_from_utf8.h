@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <cstdio>
+
 #include "common.h"
 
 namespace ufal {
@@ -27,6 +29,10 @@ inline string path_from_utf8(const char* str);
 inline const string& path_from_utf8(const string& str);
 #endif
 
+// Remove or rename a file given by an UTF-8 path, returning true on success.
+inline bool remove_utf8(const string& path);
+inline bool rename_utf8(const string& from, const string& to);
+
 //
 // Definitions
 //
@@ -96,6 +102,22 @@ inline const string& path_from_utf8(const string& str) {
 
 #endif
 
+inline bool remove_utf8(const string& path) {
+#ifdef _WIN32
+  return _wremove(path_from_utf8(path).c_str()) == 0;
+#else
+  return remove(path.c_str()) == 0;
+#endif
+}
+
+inline bool rename_utf8(const string& from, const string& to) {
+#ifdef _WIN32
+  return _wrename(path_from_utf8(from).c_str(), path_from_utf8(to).c_str()) == 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
 } // namespace utils
 } // namespace nametag
 } // namespace ufal
@@ -9,20 +9,36 @@
 
 #pragma once
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 #include "common.h"
-#include "classifier_feature.h"
-#include "classifier_outcome.h"
 
 namespace ufal {
 namespace nametag {
+namespace utils {
+
+//
+// Declarations
+//
 
-class classifier_instance {
- public:
-  classifier_features features;
-  classifier_outcome outcome;
+// Return the peak resident memory of the whole process in kB, or 0 if it
+// cannot be determined (which is always the case on Windows).
+inline uint64_t peak_rss_kb();
+
+//
+// Definitions
+//
 
-  classifier_instance(const classifier_features& features, const classifier_outcome& outcome) : features(features), outcome(outcome) {}
-};
+uint64_t peak_rss_kb() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+  return 0;
+}
 
+} // namespace utils
 } // namespace nametag
 } // namespace ufal
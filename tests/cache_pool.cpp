@@ -0,0 +1,126 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "utils/cache_pool.h"
+
+using namespace ufal::nametag::utils;
+using namespace std;
+
+// Cached object counting the live instances and detecting concurrent usage.
+struct counted {
+  static atomic<long> live, created;
+  atomic<bool> in_use;
+
+  counted() : in_use(false) { live++; created++; }
+  ~counted() { live--; }
+};
+atomic<long> counted::live(0), counted::created(0);
+
+static atomic<long> failures(0);
+
+static bool check(bool condition, const char* message) {
+  if (!condition) cerr << "Check failed: " << message << endl, failures++;
+  return condition;
+}
+
+// Every thread repeatedly pops up to max_held objects, uses them and pushes
+// them back; returns the number of performed pops.
+static long run_threads(cache_pool<counted>& pool, unsigned threads_count, unsigned iterations, unsigned max_held) {
+  atomic<long> pops(0);
+  vector<thread> threads;
+  for (unsigned t = 0; t < threads_count; t++)
+    threads.emplace_back([&pool, &pops, t, iterations, max_held] {
+      vector<counted*> held;
+      for (unsigned i = 0; i < iterations; i++) {
+        unsigned count = 1 + (i * 7 + t) % max_held;
+        for (unsigned j = 0; j < count; j++, pops++) {
+          counted* c = pool.pop();
+          if (!c) c = new counted();
+          check(!c->in_use.exchange(true), "object returned by pop is used by another thread");
+          held.push_back(c);
+        }
+        this_thread::yield();
+        for (auto&& c : held) {
+          c->in_use.store(false);
+          pool.push(c);
+        }
+        held.clear();
+      }
+    });
+  for (auto&& thread : threads)
+    thread.join();
+  return pops;
+}
+
+static void check_statistics(cache_pool<counted>& pool, long pops) {
+  cache_pool_statistics statistics;
+  pool.statistics(statistics);
+
+  check(long(statistics.hits + statistics.steals + statistics.misses) == pops, "every pop is counted as a hit, steal or miss");
+  check(long(statistics.misses) == counted::created, "every miss creates an object");
+  check(long(statistics.stored) == counted::live, "all live objects are stored in the pool");
+  check(long(statistics.stored + statistics.trimmed) == counted::created, "every created object is either stored or trimmed");
+}
+
+int main() {
+  unsigned threads_count = 4 * max(4u, thread::hardware_concurrency());
+
+  // Without a trim policy, no object may be deleted, even when the threads
+  // hold many more objects than there are slots.
+  {
+    cache_pool<counted> pool;
+    long pops = run_threads(pool, threads_count, 2000, 8);
+    check_statistics(pool, pops);
+
+    cache_pool_statistics statistics;
+    pool.statistics(statistics);
+    check(statistics.trimmed == 0, "no object is deleted without a trim policy");
+    check(statistics.stored > 16, "the pool grows beyond the initial slots");
+  }
+  check(counted::live == 0, "the pool deletes all stored objects");
+
+  // With a trim policy, trim and gather statistics concurrently.
+  counted::created = 0;
+  cache_pool_base::set_trim_policy(8, 0.001);
+  {
+    cache_pool<counted> pool;
+    atomic<bool> finished(false);
+    thread trimmer([&finished] {
+      cache_pool_statistics statistics;
+      while (!finished) {
+        cache_pool_base::trim_all();
+        cache_pool_base::statistics_all(statistics);
+        this_thread::yield();
+      }
+    });
+    long pops = run_threads(pool, threads_count, 2000, 8);
+    finished = true;
+    trimmer.join();
+    check_statistics(pool, pops);
+
+    cache_pool_base::trim_all();
+    cache_pool_statistics statistics;
+    pool.statistics(statistics);
+    check(statistics.stored <= 8, "trim_all keeps at most max_objects objects");
+    check(long(statistics.stored) == counted::live, "trimmed objects are deleted");
+  }
+  cache_pool_base::set_trim_policy(0, 0);
+  check(counted::live == 0, "the pool deletes all stored objects");
+
+  if (failures) return cerr << failures << " checks failed." << endl, 1;
+  cerr << "All cache pool checks passed." << endl;
+  return 0;
+}
@@ -0,0 +1,96 @@
+// This file is part of NameTag <http://github.com/ufal/nametag/>.
+//
+// Copyright 2016 Institute of Formal and Applied Linguistics, Faculty of
+// Mathematics and Physics, Charles University in Prague, Czech Republic.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "classifier/classifier_instances.h"
+
+using namespace ufal::nametag;
+using namespace std;
+
+static unsigned failures = 0;
+
+// Check that the instances contain exactly the expected features and outcomes.
+static void check(const char* name, const classifier_instances& instances, const vector<classifier_features>& features, const vector<classifier_outcome>& outcomes) {
+  if (instances.size() != features.size()) {
+    cerr << name << ": expected " << features.size() << " instances, found " << instances.size() << endl, failures++;
+    return;
+  }
+
+  classifier_features decoded;
+  for (size_t i = 0; i < features.size(); i++) {
+    instances.features(i, decoded);
+    if (decoded != features[i] || instances.outcome(i) != outcomes[i])
+      cerr << name << ": instance " << i << " differs after the round trip" << endl, failures++;
+  }
+}
+
+int main() {
+  vector<classifier_features> features;
+  vector<classifier_outcome> outcomes;
+
+  // Boundary values: empty instances, values around the 15-bit units and
+  // decreasing sequences, including the largest negative differences.
+  features.push_back({});
+  features.push_back({0});
+  features.push_back({0x7FFF, 0x8000, 0x3FFF, 0x4000, 0xFFFF, 0x10000});
+  features.push_back({0x3FFFFFFF, 0x40000000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF});
+  features.push_back({0xFFFFFFFF, 0, 0x80000000, 0, 0x7FFFFFFF, 1});
+  features.push_back({5, 4, 3, 2, 1, 0});
+  features.push_back({});
+
+  // Random instances with both small and large differences
+  mt19937 generator(42);
+  for (int i = 0; i < 10000; i++) {
+    features.emplace_back();
+    unsigned count = generator() % 20;
+    for (unsigned j = 0; j < count; j++)
+      features.back().push_back(generator() % 3 ? generator() % 4096 + (features.back().empty() ? 0 : features.back().back()) : generator());
+  }
+  for (size_t i = 0; i < features.size(); i++)
+    outcomes.push_back(generator() % 1000);
+
+  classifier_instances instances;
+  for (size_t i = 0; i < features.size(); i++)
+    instances.add(features[i], outcomes[i]);
+  check("add", instances, features, outcomes);
+
+  // Appending to instances, both empty and nonempty
+  classifier_instances appended;
+  appended.append(instances);
+  check("append to empty", appended, features, outcomes);
+
+  vector<classifier_features> doubled_features(features);
+  vector<classifier_outcome> doubled_outcomes(outcomes);
+  doubled_features.insert(doubled_features.end(), features.begin(), features.end());
+  doubled_outcomes.insert(doubled_outcomes.end(), outcomes.begin(), outcomes.end());
+  appended.append(instances);
+  check("append to nonempty", appended, doubled_features, doubled_outcomes);
+
+  // Serialization, also of empty instances
+  stringstream stream;
+  instances.save(stream);
+  classifier_instances().save(stream);
+
+  classifier_instances loaded;
+  if (!loaded.load(stream)) cerr << "load: cannot load saved instances" << endl, failures++;
+  check("load", loaded, features, outcomes);
+  if (!loaded.load(stream)) cerr << "load: cannot load saved empty instances" << endl, failures++;
+  check("load empty", loaded, vector<classifier_features>(), vector<classifier_outcome>());
+
+  instances.clear();
+  check("clear", instances, vector<classifier_features>(), vector<classifier_outcome>());
+
+  if (failures) return cerr << failures << " checks failed." << endl, 1;
+  cerr << "All classifier instances checks passed." << endl;
+  return 0;
+}
@@ -24,6 +24,8 @@ using namespace ufal::nametag::utils;
 using namespace std;
 
 static void sort_entities(vector<named_entity>& entities);
+static bool equal_entities(const vector<named_entity>& a, const vector<named_entity>& b);
+static size_t utf8_length(const char* str, size_t len);
 
 int main(int argc, char* argv[]) {
   if (argc < 2) return cerr << "Usage: " << argv[0] << " ner_file" << endl, 1;
@@ -40,15 +42,25 @@ int main(int argc, char* argv[]) {
   vector<string_piece> forms;
   vector<named_entity> entities;
   vector<size_t> entity_ends;
+  vector<vector<string_piece>> sentences;
+  vector<vector<named_entity>> sentences_entities, batch_entities;
+  vector<named_entity_id> entity_ids;
+  vector<entity_span> spans;
+  vector<string> entity_types;
+  recognizer->entity_types(entity_types);
 
   clock_t now = clock();
   while (getpara(cin, para)) {
     // Tokenize the text and find named entities
     tokenizer->set_text(para);
     const char* unprinted = para.c_str();
+    sentences.clear();
+    sentences_entities.clear();
     while (tokenizer->next_sentence(&forms, nullptr)) {
       recognizer->recognize(forms, entities);
       sort_entities(entities);
+      sentences.push_back(forms);
+      sentences_entities.push_back(entities);
 
       for (unsigned i = 0, e = 0; i < forms.size(); i++) {
         if (unprinted < forms[i].str) cout << xml_encoded(string_piece(unprinted, forms[i].str - unprinted));
@@ -75,12 +87,68 @@ int main(int argc, char* argv[]) {
     // Write rest of the text (should be just spaces)
     if (unprinted < para.c_str() + para.size()) cout << xml_encoded(string_piece(unprinted, para.c_str() + para.size() - unprinted));
     cout << flush;
+
+    // Check that recognizing the sentences in a batch gives the same entities
+    recognizer->recognize_batch(sentences, batch_entities);
+    if (batch_entities.size() != sentences.size()) return cerr << "The recognize_batch returned wrong number of sentences!" << endl, 1;
+    for (unsigned s = 0; s < sentences.size(); s++) {
+      sort_entities(batch_entities[s]);
+      if (!equal_entities(batch_entities[s], sentences_entities[s])) return cerr << "The recognize_batch returned different entities than recognize!" << endl, 1;
+    }
+
+    // Check that recognize_ids gives the same entities, with type indices
+    for (unsigned s = 0; s < sentences.size(); s++) {
+      recognizer->recognize_ids(sentences[s], entity_ids);
+      entities.clear();
+      for (auto&& entity : entity_ids) {
+        if (entity.type >= entity_types.size()) return cerr << "The recognize_ids returned an invalid entity type!" << endl, 1;
+        entities.emplace_back(entity.start, entity.length, entity_types[entity.type]);
+      }
+      sort_entities(entities);
+      if (!equal_entities(entities, sentences_entities[s])) return cerr << "The recognize_ids returned different entities than recognize!" << endl, 1;
+    }
+
+    // Check that recognize_text gives the same entities, with byte offsets
+    // and character offsets (which differ for non-ASCII text) computed
+    // from the tokenized forms.
+    if (!recognizer->recognize_text(para, spans)) return cerr << "The recognize_text failed!" << endl, 1;
+    for (unsigned s = 0; s < sentences.size(); s++)
+      for (auto&& entity : sentences_entities[s]) {
+        const char* start = sentences[s][entity.start].str;
+        const char* end = sentences[s][entity.start + entity.length - 1].str + sentences[s][entity.start + entity.length - 1].len;
+        size_t byte_start = start - para.c_str(), byte_length = end - start;
+        size_t char_start = utf8_length(para.c_str(), byte_start), char_length = utf8_length(start, byte_length);
+
+        bool found = false;
+        for (size_t i = 0; i < spans.size() && !found; i++)
+          found = spans[i].start == byte_start && spans[i].length == byte_length && spans[i].char_start == char_start &&
+              spans[i].char_length == char_length && spans[i].type == entity.type;
+        if (!found) return cerr << "The recognize_text did not return entity '" << string(start, end - start) << "' with correct offsets!" << endl, 1;
+      }
+    size_t expected_spans = 0;
+    for (auto&& sentence_entities : sentences_entities) expected_spans += sentence_entities.size();
+    if (spans.size() != expected_spans) return cerr << "The recognize_text returned different number of entities than recognize!" << endl, 1;
   }
   cerr << "Recognizing done, in " << fixed << setprecision(3) << (clock() - now) / double(CLOCKS_PER_SEC) << " seconds." << endl;
 
   return 0;
 }
 
+bool equal_entities(const vector<named_entity>& a, const vector<named_entity>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].start != b[i].start || a[i].length != b[i].length || a[i].type != b[i].type)
+      return false;
+  return true;
+}
+
+size_t utf8_length(const char* str, size_t len) {
+  size_t chars = 0;
+  for (size_t i = 0; i < len; i++)
+    chars += (((unsigned char)str[i]) & 0xC0) != 0x80;
+  return chars;
+}
+
 void sort_entities(vector<named_entity>& entities) {
   struct named_entity_comparator {
     static bool lt(const named_entity& a, const named_entity& b) {